@@ -1,12 +1,14 @@
 #ifndef BVH_H
 #define BVH_H
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <limits>
 #include <memory>
 #include <stack>
 #include "aabb.h"
+#include "frame-arena.h"
 #include "debug.h"
 // #include "physical-object.h"
 
@@ -28,12 +30,22 @@ struct TreeNode {
 class Bvh {
 public:
     // Usually, this will be physical objects.
-    vector<pair<void*, void*>> collisionPairs;
+    // Rebuilt every step, so it lives in the frame arena when there is one.
+    FrameVector<pair<void*, void*>> collisionPairs;
+    FrameArena* frameArena = nullptr;
 
     Bvh() : _root(nullptr), _nodeCount(0), _insertionCount(0) {
         // DEBUG_PRINT("BVH created.");
     }
 
+    Bvh(const Bvh&) = delete;
+    Bvh& operator=(const Bvh&) = delete;
+
+    ~Bvh() {
+        clear();
+        releasePool();
+    }
+
     // Insert a new object into the tree, returning a pointer to the new node
     TreeNode* insert(const Aabb& aabb, void* userData) {
         // DEBUG_PRINT("Inserting AABB.");
@@ -44,6 +56,22 @@ public:
         return node;
     }
 
+    // Insert many objects at once, filling leaves with their nodes (in the same order).
+    // The new leaves are built into a balanced subtree, which is then inserted as a whole. This is
+    // much faster than one insert per object and gives a better tree for objects added together.
+    void insertBatch(const vector<Aabb>& aabbs, const vector<void*>& userData, vector<TreeNode*>& leaves) {
+        size_t count = aabbs.size();
+        leaves.resize(count);
+        if (count == 0) return;
+
+        for (size_t i = 0; i < count; i++) leaves[i] = _allocateNode(aabbs[i], userData[i]);
+
+        vector<TreeNode*> order(leaves);
+        _insertNode(_buildSubtree(order, 0, count));
+        _nodeCount += static_cast<int>(count);
+        _insertionCount += static_cast<int>(count);
+    }
+
     // Remove an object from the tree
     void remove(TreeNode* node) {
         // cout << "Removing node." << endl;
@@ -54,11 +82,13 @@ public:
 
         // Whene a leaf is removed, it's parent is always a partial parent and can also be removed.
         if(parent) {
+            auto* grandparent = parent->parent;
             _removeNode(parent);
             _deallocateNode(parent);
-        }
 
-        _updateTree(node);
+            // The ancestors' bounds may only shrink, so refit all the way up.
+            _refitToRoot(grandparent);
+        }
     }
 
     // Update the position of an object in the tree (e.g., when it moves)
@@ -72,24 +102,22 @@ public:
 
         _removeNode(node);
 
-        // There could potentially be a faster way to do this by recycling the parent.
-        // But for now, this will work.
-        // This is worth looking into since updates happen frequently.
+        // The parent is unlinked too, and reused for the reinsertion if it needs a new parent, so
+        // moving objects don't allocate.
         if(parent) {
             _removeNode(parent);
-            _deallocateNode(parent);
             _nodeCount--;
         }
 
         node->aabb = newAABB;
-        _insertNode(node);
+        _insertNode(node, parent);
 
         // cout << _nodeCount << endl;
     }
 
     // Deallocate all nodes.
     void clear() {
-        collisionPairs.clear();
+        resetFrameVector(collisionPairs, frameArena);
         if (!_root) return;  // No tree to clear
 
         stack<TreeNode*> stack;
@@ -126,13 +154,27 @@ public:
 
     // void traverseAndCheckCollisions(std::function<void(void*, void*)> callback){
     void traverseAndCheckCollisions(){
-        collisionPairs.clear();
+        resetFrameVector(collisionPairs, frameArena);
+        if(_root == nullptr) return;
         _traverseAndCheckCollisions(_root->left, _root->right);
     }
 
 
+    // Nodes in the tree, and nodes kept for reuse.
+    size_t liveNodeCount() const { return _liveNodes; }
+    size_t freeNodeCount() const { return _freeNodes.size(); }
+
+    // Free the nodes kept for reuse.
+    void releasePool() {
+        for (TreeNode* node : _freeNodes) delete node;
+        _freeNodes.clear();
+        _freeNodes.shrink_to_fit();
+    }
+
 // private:
     TreeNode* _root;
+    vector<TreeNode*> _freeNodes;
+    size_t _liveNodes = 0;
     int _nodeCount;
     int _insertionCount;
 
@@ -140,60 +182,89 @@ public:
     // then if it's equal to the number of nodes, we don't need to traverse.
     // We could do something similar with nodes that contain leafs in 
     // non-colliding masks.
+    // Reports every overlapping leaf pair once: pairs within node1, within node2, and across them.
     void _traverseAndCheckCollisions(TreeNode* node1, TreeNode* node2) {
-        if (!node1 && !node2) return;
-        else if(!node2) _traverseAndCheckCollisions(node1->left, node1->right);
-        else if(!node1) _traverseAndCheckCollisions(node2->left, node2->right);
-        else if(node1->isLeaf() && node2->isLeaf()){
-            if(node1->aabb.overlaps(node2->aabb)){
-                // callback(node1->userData, node2->userData);
-                // auto* obj1 = static_cast<PhysicalObject*>(node1->userData);
-                // auto* obj2 = static_cast<PhysicalObject*>(node2->userData);
-                collisionPairs.push_back({node1->userData, node2->userData});
-            }
+        if (node1 && !node1->isLeaf()) _traverseAndCheckCollisions(node1->left, node1->right);
+        if (node2 && !node2->isLeaf()) _traverseAndCheckCollisions(node2->left, node2->right);
+        if (node1 && node2) _checkNodePair(node1, node2);
+    }
+
+    // Overlapping leaf pairs with one leaf under each node. Internal bounds contain their
+    // children, so disjoint subtrees are skipped.
+    void _checkNodePair(TreeNode* node1, TreeNode* node2) {
+        if (!node1->aabb.overlaps(node2->aabb)) return;
+
+        if (node1->isLeaf() && node2->isLeaf()) {
+            collisionPairs.push_back({node1->userData, node2->userData});
         }
-        else if(node1->isLeaf()){
-            // Right is a leaf node. Try it against left's children.
-            _traverseAndCheckCollisions(node1, node2->left);
-            _traverseAndCheckCollisions(node1, node2->right);
-            _traverseAndCheckCollisions(node1->left, node2);
+        else if (node1->isLeaf() || (!node2->isLeaf() && node2->aabb.getSurfaceArea() > node1->aabb.getSurfaceArea())) {
+            // Descend into the larger (or only internal) node.
+            if (node2->left) _checkNodePair(node1, node2->left);
+            if (node2->right) _checkNodePair(node1, node2->right);
         }
-        else if(node2->isLeaf()){
-            // Left is a leaf node. Try it against right's children.
-            _traverseAndCheckCollisions(node1->left, node2);
-            _traverseAndCheckCollisions(node1->right, node2);
-            _traverseAndCheckCollisions(node1, node2->left);
+        else {
+            if (node1->left) _checkNodePair(node1->left, node2);
+            if (node1->right) _checkNodePair(node1->right, node2);
         }
-        else{
-            // Neither side is a leaf node.
-            _traverseAndCheckCollisions(node1->left, node1->right);
-            _traverseAndCheckCollisions(node2->left, node2->right);
-
-            _traverseAndCheckCollisions(node1->left, node2->left);
-            _traverseAndCheckCollisions(node1->left, node2->right);
-            _traverseAndCheckCollisions(node1->right, node2->left);
-            _traverseAndCheckCollisions(node1->right, node2->right);
+    }
+
+    // Build a subtree over nodes[begin, end) by splitting at the median center along the longer
+    // axis of the centers' bounds. Returns its root.
+    TreeNode* _buildSubtree(vector<TreeNode*>& nodes, size_t begin, size_t end) {
+        if (end - begin == 1) return nodes[begin];
+
+        Vec2 low = nodes[begin]->aabb.getCenter();
+        Vec2 high = low;
+        for (size_t i = begin + 1; i < end; i++) {
+            Vec2 center = nodes[i]->aabb.getCenter();
+            low = Vec2(min(low.x, center.x), min(low.y, center.y));
+            high = Vec2(max(high.x, center.x), max(high.y, center.y));
         }
+        bool alongX = high.x - low.x >= high.y - low.y;
+
+        size_t middle = begin + (end - begin) / 2;
+        nth_element(nodes.begin() + begin, nodes.begin() + middle, nodes.begin() + end,
+            [alongX](const TreeNode* a, const TreeNode* b) {
+                return alongX ? a->aabb.getCenter().x < b->aabb.getCenter().x : a->aabb.getCenter().y < b->aabb.getCenter().y;
+            });
+
+        TreeNode* left = _buildSubtree(nodes, begin, middle);
+        TreeNode* right = _buildSubtree(nodes, middle, end);
+        TreeNode* parent = _allocateNode(_combineAabbs(left->aabb, right->aabb), nullptr);
+        parent->left = left;
+        parent->right = right;
+        left->parent = parent;
+        right->parent = parent;
+        return parent;
     }
 
-    // Allocate a new node
+    // Allocate a new node. Deallocated nodes are kept and reused, so objects coming and going
+    // don't allocate.
     TreeNode* _allocateNode(const Aabb& aabb, void* userData) {
         // DEBUG_PRINT("    Allocating node.");
-        TreeNode* node = new TreeNode(aabb, userData);
+        _liveNodes++;
+        if (_freeNodes.empty()) return new TreeNode(aabb, userData);
+
+        TreeNode* node = _freeNodes.back();
+        _freeNodes.pop_back();
+        *node = TreeNode(aabb, userData);
         return node;
     }
 
     // Deallocate a node
     void _deallocateNode(TreeNode* node) {
         // DEBUG_PRINT("    Deallocating node.");
-        delete node;
+        _liveNodes--;
+        _freeNodes.push_back(node);
     }
 
-    // Insert a node into the tree
-    void _insertNode(TreeNode* node) {
+    // Insert a node into the tree. spare is an unlinked node to use as the new parent, or null.
+    // If it isn't needed, it's deallocated.
+    void _insertNode(TreeNode* node, TreeNode* spare = nullptr) {
         // DEBUG_PRINT("    Inserting node.");
         if (_root == nullptr) {
             _root = node;
+            if (spare) _deallocateNode(spare);
             return;
         }
 
@@ -206,7 +277,10 @@ public:
             if(current->isLeaf()){
                 // Now current is a leaf node, so we create a new parent node
                 TreeNode* oldParent = current->parent;
-                TreeNode* newParent = _allocateNode(_combineAabbs(current->aabb, node->aabb), nullptr);
+                TreeNode* newParent = spare ? spare : _allocateNode(Aabb(), nullptr);
+                spare = nullptr;
+                newParent->aabb = _combineAabbs(current->aabb, node->aabb);
+                newParent->userData = nullptr;
 
                 newParent->left = current;
                 newParent->right = node;
@@ -256,8 +330,10 @@ public:
             }
         }
 
-        // Update the tree upwards
-        _updateTree(current);
+        if (spare) _deallocateNode(spare);
+
+        // Refit the ancestors of the new leaf.
+        _updateTree(node->parent);
     }
 
     // Remove a node from the tree
@@ -351,6 +427,12 @@ public:
         // }
     }
 
+    // Whether outer contains inner entirely
+    bool _containsAabb(const Aabb& outer, const Aabb& inner) const {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y
+            && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y;
+    }
+
     // Combine two AABBs into one
     Aabb _combineAabbs(const Aabb& a, const Aabb& b) const {
         // DEBUG_PRINT("    Combining AABBs.");
@@ -365,8 +447,6 @@ public:
     // Update the tree after an insertion or removal
     void _updateTree(TreeNode* node) {
         while (node != nullptr) {
-            Aabb oldAABB = node->aabb;
-
             // Ensure both left and right children exist before combining AABBs
             if (node->left != nullptr && node->right != nullptr) {
                 node->aabb = _combineAabbs(node->left->aabb, node->right->aabb);
@@ -378,8 +458,9 @@ public:
                 node->aabb = node->right->aabb;
             }
 
-            // Check if the AABB needs further updating
-            if (oldAABB.containsPoint(node->aabb.getCenter())) {
+            // Every ancestor must contain its children for the traversal to prune on it, so keep
+            // refitting until an ancestor already contains the new bounds.
+            if (node->parent != nullptr && _containsAabb(node->parent->aabb, node->aabb)) {
                 break;
             }
 
@@ -389,6 +470,16 @@ public:
     }
 
 
+    // Recompute the bounds of node and every ancestor. Unlike _updateTree this never stops early,
+    // so bounds that shrank are tightened too.
+    void _refitToRoot(TreeNode* node) {
+        for (; node != nullptr; node = node->parent) {
+            if (node->left && node->right) node->aabb = _combineAabbs(node->left->aabb, node->right->aabb);
+            else if (node->left) node->aabb = node->left->aabb;
+            else if (node->right) node->aabb = node->right->aabb;
+        }
+    }
+
     // Recursive query function to find potential overlaps
     void _queryNode(TreeNode* node, const Aabb& aabb, vector<void*>& results) const {
         // DEBUG_PRINT("    Querying node.");
@@ -1,13 +1,44 @@
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 #include <functional>
 #include <iostream>
 
 #include "vec2.h"
+#include "constants.h"
+#include "shape-cache.h"
+#include "compound.h"
+#include "tilemap.h"
+#include "frame-arena.h"
 
 using namespace std;
 
+#define MAX_MANIFOLD_POINTS 2
+
+struct ContactPoint {
+    Vec2 point;
+    float penetrationDepth;
+    // Identifies the pair of features (edges/vertices) that produced this point.
+    // Used to match points between steps.
+    int featureId;
+
+    // Accumulated impulses, carried over between steps when the feature matches.
+    float normalImpulse;
+    float tangentImpulse;
+};
+
+// Contact state that persists between steps for as long as a pair stays in contact.
+struct ContactManifold {
+    int pointCount;
+    ContactPoint points[MAX_MANIFOLD_POINTS];
+    int stamp; // Last step this manifold was touched.
+    int firstStamp; // Step the pair started touching.
+    int idA;
+    int idB;
+    Vec2 normal; // From A to B, as of the last step.
+};
+
 struct CollisionInfo {
     bool isColliding;
     Vec2 contactPoint;
@@ -15,25 +46,124 @@ struct CollisionInfo {
     float penetrationDepth;
     int indexA;
     int indexB;
+    int childA; // Child shapes of compound bodies, or -1.
+    int childB;
     Vec2 relativeVelocity;
 
     // Set after collision resolution
     float normalImpulseMagnitude;
+
+    int pointCount;
+    ContactPoint points[MAX_MANIFOLD_POINTS];
+
+    // Persistent manifold for this pair. Set by CollisionSolver::updateManifolds.
+    uint64_t key;
+    ContactManifold* manifold;
+};
+
+// Axis that the last SAT test of a polygon pair ended on: the separating edge if the pair was
+// apart, the reference edge if it was touching.
+struct SatCacheEntry {
+    int firstId; // Id of the object that was A. flip is relative to it.
+    int edge;
+    int flip; // 0: edge of A, 1: edge of B.
+    int stamp;
+};
+
+// Narrow phase result of a pair whose objects had not moved since the previous narrow phase.
+struct PairResult {
+    int stamp; // Last step this result was produced or reused.
+    int indexA;
+    int indexB;
+    bool hit;
+    CollisionInfo info;
 };
 
+// Order-independent key for a pair of object ids.
+inline uint64_t makePairKey(int idA, int idB) {
+    uint32_t lo = static_cast<uint32_t>(idA < idB ? idA : idB);
+    uint32_t hi = static_cast<uint32_t>(idA < idB ? idB : idA);
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+// Key for a pair of child shapes of two bodies (child -1 for a body that is not compound). The
+// children are hashed into the pair key, so a clash between two child pairs only costs warm starting.
+inline uint64_t makeChildPairKey(int idA, int childA, int idB, int childB) {
+    uint64_t key = makePairKey(idA, idB);
+    if (childA < 0 && childB < 0) return key;
+
+    uint32_t lo = static_cast<uint32_t>((idA < idB ? childA : childB) + 1);
+    uint32_t hi = static_cast<uint32_t>((idA < idB ? childB : childA) + 1);
+    return key ^ (((static_cast<uint64_t>(hi) << 32) | lo) * 0x9E3779B97F4A7C15ull);
+}
+
 class CollisionSolver {
 public:
 
-    vector<CollisionInfo> collisions;
+    // Per-step buffers (collisions, endedManifolds and the pair buckets) live in the frame arena
+    // when there is one.
+    FrameVector<CollisionInfo> collisions;
+    FrameArena* frameArena = nullptr;
+
+    // Persistent manifolds by object id pair.
+    unordered_map<uint64_t, ContactManifold> manifolds;
+    int manifoldStamp = 0;
+
+    // Manifolds dropped by the last updateManifolds: pairs that stopped touching.
+    FrameVector<ContactManifold> endedManifolds;
+
+    // Manifolds taken out by dropTerrainManifolds, by pair key, until the next updateManifolds ends
+    // them.
+    unordered_map<uint64_t, ContactManifold> droppedManifolds;
+
+    // Last SAT axis by object id pair, for polygon pairs tested in the last step.
+    unordered_map<uint64_t, SatCacheEntry> satCache;
+
+    // Last step's results of pairs whose objects were both at rest, by object id pair.
+    unordered_map<uint64_t, PairResult> pairResults;
+    int pairStamp = 0;
+
     vector<int>& intData;
     vector<float>& floatData;
+    vector<ShapeCache>& shapes;
 
-    CollisionSolver(vector<int>& intData, vector<float>& floatData);
+    CollisionSolver(vector<int>& intData, vector<float>& floatData, vector<ShapeCache>& shapes);
 
     void clear();
+    void clearManifolds();
+    // Drop the manifolds of contacts with the terrain, so nothing is warm started against terrain
+    // that has changed. The next updateManifolds ends them, unless the same pair touches again.
+    void dropTerrainManifolds();
+
+    // Match this step's contacts against last step's manifolds by feature id and carry the
+    // accumulated impulses over. Manifolds that were not touched this step are dropped, and kept
+    // in endedManifolds until the next call.
+    void updateManifolds();
     
     bool solve(int indexA, int indexB);
 
+    // Whether the shapes of two objects intersect. Runs the regular narrow phase and discards the
+    // contacts.
+    bool overlaps(int indexA, int indexB);
+
+    // Batched narrow phase. addPair buckets pairs by shape pair, and solvePairs runs the
+    // circle-circle, AABB-AABB and circle-box buckets through branch-free kernels over blocks of
+    // lanes (structure of arrays, so the compiler vectorizes them: SSE/AVX natively, SIMD128 in
+    // WASM). The lanes that hit build their contacts from the kernel's outputs, without testing
+    // the pair again. Other pairs go through solve().
+    // Pairs added with cacheable set (neither object moved since the last narrow phase) have
+    // their result kept, so the next step can take it back with reusePair if they still haven't.
+    void addPair(int indexA, int indexB, bool cacheable = false);
+    void solvePairs();
+
+    // Push last step's result for a pair whose objects have not moved since. Returns false if
+    // there is none, and the pair has to be added.
+    bool reusePair(int indexA, int indexB);
+    void _storePairResults(size_t firstCollision);
+    void _solveCircleCirclePairs();
+    void _solveAabbAabbPairs();
+    void _solveCircleBoxPairs();
+
     // Get the correct solver for the obj types
     bool _solveAabbAabb();
     
@@ -43,4 +173,64 @@ public:
     bool _solveBoxBox();
     bool _solveAabbBox();
     bool _solveCircleBox();
-};
\ No newline at end of file
+
+    // Polygons against any shape with a cached outline (AABB, BOX, POLYGON), and against circles.
+    bool _solveOutlines();
+    bool _solveCirclePolygon();
+    bool _collideCirclePolygon(const Vec2& center, float radius, const Vec2* vertices, const Vec2* normals, int count,
+                               bool circleIsB);
+
+    // Compound bodies against anything: every child pair whose bounds touch is collided as two
+    // convex pieces.
+    bool _solveCompound();
+
+    // Capsules against anything, as convex pieces. Rounded segments (circles and capsules) use
+    // segment distance. Against outlines, capsules get a corner contact from their closest points,
+    // or else go through SAT as rounded two vertex polygons.
+    bool _solveConvex();
+    bool _collideSegments(const Vec2& p1, const Vec2& q1, float radius1, const Vec2& p2, const Vec2& q2, float radius2);
+    bool _collideCapsulePolygon(const ConvexGeometry& capsule, const ConvexGeometry& polygon, bool capsuleIsB);
+
+    // Collide the body at index (as A) with the terrain rectangles under it (as B, TERRAIN_INDEX).
+    // Contacts on faces shared with other solid tiles are dropped, and corner normals that lean
+    // into them are straightened, so bodies slide across tile seams without snagging.
+    bool solveTerrain(int index, const Tilemap& tilemap);
+    void _filterTerrainContact(const Tilemap& tilemap, const TileRect& rect);
+
+    bool _collideConvex(const ConvexGeometry& a, const ConvexGeometry& b);
+    bool _bodyGeometry(int index, ConvexGeometry& geometry);
+
+    // SAT with reference/incident edge clipping. Vertices and outward edge normals are in world space.
+    bool _collidePolygons(const Vec2* verticesA, const Vec2* normalsA, int countA, float radiusA,
+                          const Vec2* verticesB, const Vec2* normalsB, int countB, float radiusB);
+
+    void _beginPair(int indexA, int indexB);
+    void _addCollision(const Vec2& normal, const ContactPoint* points, int pointCount);
+    // Contact builders shared by the scalar tests and the kernels, so both give the same contacts.
+    void _addAabbContact(const Vec2& centerA, const Vec2& centerB, float overlapMinX, float overlapMaxX,
+                         float overlapMinY, float overlapMaxY);
+    void _addCircleBoxContact(float radius, const Vec2& boxCenter, const Vec2& axisX, const Vec2& axisY,
+                              const Vec2& closestPointLocal, const Vec2& distanceVecLocal);
+
+private:
+    int _idOf(int index) const {
+        return index == TERRAIN_INDEX ? TERRAIN_ID : intData[index * LIVE_INT_EPO + LIVE_INT_ID];
+    }
+
+    // Index pairs, two ints per pair. Circle-box pairs are stored circle first.
+    FrameVector<int> _circleCirclePairs;
+    FrameVector<int> _aabbAabbPairs;
+    FrameVector<int> _circleBoxPairs;
+    FrameVector<int> _otherPairs;
+    FrameVector<int> _cacheablePairs;
+};
+
+// Narrow phase for one ordered pair of shapes, used to build CollisionSolver's dispatch table.
+// New pairs plug in by specializing this (in collision-solver.cpp) with supported = true. Only one
+// order needs a specialization: the table swaps the objects for the other order. Pairs with no
+// specialization either way are a no-op.
+template<ObjectShape A, ObjectShape B>
+struct PairSolver {
+    static constexpr bool supported = false;
+    static bool solve(CollisionSolver&) { return false; }
+};
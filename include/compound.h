@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include "vec2.h"
+#include "aabb.h"
+#include "constants.h"
+
+using namespace std;
+
+// Floats per child in the flat child list passed to buildCompound:
+// shape, x, y, r, width (radius for circles), height, mass.
+#define COMPOUND_CHILD_EPO 7
+
+// A convex piece in world space: a circle (one vertex and a radius) or an outline whose normal i
+// belongs to the edge from vertex i to vertex i + 1.
+struct ConvexGeometry {
+    int vertexCount;
+    float radius;
+    Vec2 vertices[MAX_POLYGON_VERTICES];
+    Vec2 normals[MAX_POLYGON_VERTICES];
+    Aabb bounds;
+};
+
+struct CompoundChild {
+    ObjectShape shape; // CIRCLE or BOX.
+    Vec2 offset; // Relative to the body's center of mass.
+    float rotation;
+    float width; // Radius for circles.
+    float height;
+    float mass;
+};
+
+// Node of the local tree. Leaves have a child index, inner nodes have two nodes below them.
+struct CompoundNode {
+    Aabb bounds; // In body space.
+    int left;
+    int right;
+    int child;
+};
+
+// A rigid body made of several child shapes. The body has one broad phase proxy. The narrow phase
+// finds the children that touch the other body through a small static tree built in body space.
+struct Compound {
+    vector<CompoundChild> children;
+    vector<CompoundNode> nodes; // nodes[0] is the root.
+    vector<ConvexGeometry> geometry; // World space, per child. Rebuilt when the body moves.
+    Aabb bounds; // World space union of the children.
+    float mass;
+    Vec2 centerOfMass; // Where the children's masses balance, relative to the original origin.
+};
+
+// Build a compound from a flat child list (COMPOUND_CHILD_EPO floats per child). Children are
+// re-centered on their center of mass. Returns false if the list is empty or has a child that is
+// not a CIRCLE or BOX.
+bool buildCompound(const vector<float>& childData, Compound& compound);
+
+// Transform the children into world space.
+void updateCompoundGeometry(Compound& compound, const Vec2& position, const Vec2& axisX);
+
+// Call fn(childIndex) for every child whose body space bounds overlap localBounds.
+template<typename F>
+void queryCompound(const Compound& compound, const Aabb& localBounds, F fn) {
+    if (compound.nodes.empty()) return;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const CompoundNode& node = compound.nodes[stack[--top]];
+        if (!node.bounds.overlaps(localBounds)) continue;
+
+        if (node.child >= 0) fn(node.child);
+        else {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+// Bounds of a world space box, seen from a body at position with the given x axis.
+Aabb toBodySpace(const Aabb& worldBounds, const Vec2& position, const Vec2& axisX);
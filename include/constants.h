@@ -1,10 +1,20 @@
 #pragma once
 
-#define LIVE_INT_EPO 4
+#include <cstdint>
+
+#define LIVE_INT_EPO 6
 #define LIVE_INT_ID 0
 #define LIVE_INT_SHAPE 1
 #define LIVE_INT_TYPE 2
 #define LIVE_INT_HAS_COLLISION 3
+#define LIVE_INT_SHAPE_DATA 4 // Offset of the object's polygon record, or -1.
+#define LIVE_INT_MATERIAL 5 // Id in the world's material table.
+
+// Materials (restitution, friction and damping) are shared through a table. Ids below are always
+// there; the terrain's material is the one setTerrainMaterial changes.
+#define MAX_MATERIALS 256
+#define DEFAULT_MATERIAL 0
+#define TERRAIN_MATERIAL 1
 
 // Int flags
 // Shape and Object Type
@@ -21,14 +31,26 @@ enum class ObjectShape {
     BOX,
     ELLIPSE,
     CAPSULE,
-    POLYGON
+    POLYGON,
+    COMPOUND
 };
+#define OBJECT_SHAPE_COUNT 8
+
+// Convex polygons live in a shared pool of fixed size records:
+// vertex count, then local vertices (x, y) and outward edge normals (x, y), counter-clockwise.
+#define MAX_POLYGON_VERTICES 8
+#define POLYGON_RECORD_SIZE (1 + MAX_POLYGON_VERTICES * 4)
+
+// Stands in for the static terrain (World's tilemap) as body B of a collision. The terrain has no
+// live data; its pair keys use TERRAIN_ID.
+#define TERRAIN_INDEX -1
+#define TERRAIN_ID INT32_MIN
 
 // Collision type.
 #define HAS_AABB_COLLISION 0x1
 #define HAS_PHYSICAL_COLLISION 0x2
 
-#define FDATA_EPO 28
+#define FDATA_EPO 25
 #define FDATA_X 0 // Position
 #define FDATA_Y 1 // Position
 #define FDATA_R 2 // Rotation
@@ -38,23 +60,54 @@ enum class ObjectShape {
 #define FDATA_M 6 // Mass
 #define FDATA_IM 7 // Inverse Mass
 #define FDATA_G_SCALE 8 // How much gravity affects this object.
-#define FDATA_RESTITUTION 9 // Bounciness
-#define FDATA_S_FRICTION 10 // Static friction
-#define FDATA_K_FRICTION 11 // Kinetic friction
-#define FDATA_DAMPING 12 // Linear damping (air resistance)
-#define FDATA_ANGULAR_DAMPING 13 // Angular damping
-#define FDATA_W 14 // Width
-#define FDATA_RADIUS 14 // Radius
-#define FDATA_H 15 // Height
-#define FDATA_FX 16 // Force accumulator (READ ONLY)
-#define FDATA_FY 17 // Force accumulator (READ ONLY)
-#define FDATA_IX 18
-#define FDATA_IY 19
-#define FDATA_AX1 20
-#define FDATA_AY1 21
-#define FDATA_AX2 22
-#define FDATA_AY2 23
-#define FDATA_NFX 24
-#define FDATA_NFY 25
-#define FDATA_NIX 26
-#define FDATA_NIY 27
\ No newline at end of file
+#define FDATA_W 9 // Width
+#define FDATA_RADIUS 9 // Radius
+#define FDATA_H 10 // Height
+#define FDATA_FX 11 // Force accumulator (READ ONLY)
+#define FDATA_FY 12 // Force accumulator (READ ONLY)
+#define FDATA_IX 13
+#define FDATA_IY 14
+#define FDATA_AX1 15
+#define FDATA_AY1 16
+#define FDATA_AX2 17
+#define FDATA_AY2 18
+#define FDATA_NFX 19
+#define FDATA_NFY 20
+#define FDATA_NIX 21
+#define FDATA_NIY 22
+#define FDATA_COS 23 // Rotation as a unit complex number, kept in sync with FDATA_R.
+#define FDATA_SIN 24
+
+// Collision events of the last step (or advance call). The int buffer starts with the event count.
+enum class CollisionEventType {
+    BEGIN,
+    PERSIST,
+    END
+};
+#define EVENT_HEADER 1
+#define EVENT_INT_EPO 3
+#define EVENT_TYPE 0
+#define EVENT_ID_A 1
+#define EVENT_ID_B 2 // TERRAIN_ID for contacts with the tilemap.
+#define EVENT_FLOAT_EPO 5
+#define EVENT_NX 0 // Normal, from A to B.
+#define EVENT_NY 1
+#define EVENT_IMPULSE 2 // Total normal impulse. 0 for END events.
+#define EVENT_PX 3 // Contact point (the last one, for END events).
+#define EVENT_PY 4
+
+// Sensor enter and exit lists of the last step (or advance call). Each starts with its record count,
+// then holds sensor id, other id per record. A pair of sensors has a record for each side.
+#define SENSOR_EVENT_HEADER 1
+#define SENSOR_EVENT_EPO 2
+#define SENSOR_EVENT_SENSOR_ID 0
+#define SENSOR_EVENT_OTHER_ID 1
+
+// Objects the per-object buffers hold before their first growth. Each growth doubles the capacity.
+#define INITIAL_OBJECT_CAPACITY 1024
+
+// Interpolated render transforms, published by World::advance.
+#define RENDER_EPO 3
+#define RENDER_X 0
+#define RENDER_Y 1
+#define RENDER_R 2
@@ -6,6 +6,8 @@
 #include <variant>
 // #include <sstream>
 
+// Stands in for emscripten::val in native builds: an object of number properties.
+// operator[] returns the property as a value, which as() converts like a JS number.
 class MockVal {
 public:
     std::unordered_map<std::string, std::variant<int, float>> properties;
@@ -16,12 +18,17 @@ public:
 
     template<typename T>
     T as() const {
-        return std::get<T>(properties.at("type"));
+        return std::visit([](auto v) { return static_cast<T>(v); }, value);
     }
 
-    MockVal& operator[](const std::string& key) {
-        return *this; // For simplicity, return the same object; you can expand this as needed.
+    MockVal operator[](const std::string& key) const {
+        MockVal property;
+        property.value = properties.at(key);
+        return property;
     }
+
+private:
+    std::variant<int, float> value = 0;
 };
 
 using emscripten_val = MockVal;  // Redefine emscripten::val to MockVal
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Linear allocator for buffers that only live for one step.
+// Allocation bumps an offset into one block, and reset() releases everything at once. A step
+// that needs more than the block holds gets extra blocks from the heap, and the next reset
+// replaces the block with one as large as the most any step has used (the high-water mark), so
+// after the first few steps a step allocates nothing from the heap.
+class FrameArena {
+public:
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    ~FrameArena() {
+        _releaseOverflow();
+        delete[] _block;
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= _capacity) {
+            _offset = offset + bytes;
+            _noteUsage();
+            return _block + offset;
+        }
+
+        // Out of room: this step gets its own block, and the next reset makes room for it.
+        size_t size = bytes + alignment;
+        unsigned char* overflow = new unsigned char[size];
+        _overflow.push_back(overflow);
+        _overflowBytes += size;
+        _noteUsage();
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(overflow);
+        return overflow + (((address + alignment - 1) & ~(alignment - 1)) - address);
+    }
+
+    // Release everything allocated since the last reset.
+    void reset() {
+        _releaseOverflow();
+        if (_shrinkPending) {
+            delete[] _block;
+            _block = nullptr;
+            _capacity = 0;
+            _shrinkPending = false;
+        }
+        if (_highWaterMark > _capacity) reserve(_highWaterMark);
+        _offset = 0;
+    }
+
+    // Make the block hold at least bytes. Only valid right after a reset.
+    void reserve(size_t bytes) {
+        if (bytes <= _capacity) return;
+
+        delete[] _block;
+        _capacity = (bytes + 4095) & ~static_cast<size_t>(4095);
+        _block = new unsigned char[_capacity];
+        _offset = 0;
+    }
+
+    // Lower the high-water mark to what is in use now, and at the next reset replace the block
+    // with one of that size. Allocations until then stay valid.
+    void shrinkOnReset() {
+        _highWaterMark = used();
+        _shrinkPending = true;
+    }
+
+    size_t used() const { return _offset + _overflowBytes; }
+    size_t capacity() const { return _capacity; }
+    size_t reserved() const { return _capacity + _overflowBytes; }
+    size_t highWaterMark() const { return _highWaterMark; }
+
+private:
+    unsigned char* _block = nullptr;
+    size_t _capacity = 0;
+    size_t _offset = 0;
+
+    vector<unsigned char*> _overflow;
+    size_t _overflowBytes = 0;
+    size_t _highWaterMark = 0;
+    bool _shrinkPending = false;
+
+    void _noteUsage() {
+        if (used() > _highWaterMark) _highWaterMark = used();
+    }
+
+    void _releaseOverflow() {
+        for (unsigned char* block : _overflow) delete[] block;
+        _overflow.clear();
+        _overflowBytes = 0;
+    }
+};
+
+// Standard allocator over a FrameArena. Without an arena it uses the heap, so containers work the
+// same outside a World (in tests, for instance).
+template<typename T>
+struct FrameAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = true_type;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    FrameArena* arena = nullptr;
+
+    FrameAllocator() = default;
+    explicit FrameAllocator(FrameArena* arena) : arena(arena) {}
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        if (arena) return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) {
+        if (!arena) ::operator delete(pointer);
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template<typename T>
+using FrameVector = vector<T, FrameAllocator<T>>;
+
+// Empty a per-step buffer before its first use in a step. With an arena, the storage it had was
+// released by the arena's reset, so it starts over on fresh arena memory. Without one, it keeps
+// its capacity.
+template<typename T>
+void resetFrameVector(FrameVector<T>& buffer, FrameArena* arena) {
+    if (arena) buffer = FrameVector<T>(FrameAllocator<T>(arena));
+    else buffer.clear();
+}
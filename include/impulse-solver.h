@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vec2.h"
+#include "collision-solver.h"
+#include "worker-pool.h"
+#include "material-table.h"
+#include "constants.h"
+
+using namespace std;
+
+// Per-contact-point solver state. Built from a CollisionInfo at the start of the resolution phase.
+struct ContactConstraint {
+    CollisionInfo* collision;
+    int pointIndex;
+    int indexA;
+    int indexB;
+
+    Vec2 normal;
+    Vec2 tangent;
+    Vec2 rA; // Lever arms (contact point relative to each center of mass).
+    Vec2 rB;
+
+    float invMassA;
+    float invMassB;
+    float invInertiaA;
+    float invInertiaB;
+
+    float normalMass; // Effective mass along the normal.
+    float tangentMass; // Effective mass along the tangent.
+
+    // Accumulated impulses. These are clamped as a whole, not per iteration.
+    float normalImpulse;
+    float tangentImpulse;
+
+    float velocityBias; // Restitution target.
+    float friction;
+    float penetrationDepth;
+
+    // Positions at the time of the narrow phase, used to track the remaining penetration.
+    Vec2 startPositionA;
+    Vec2 startPositionB;
+};
+
+// Sequential impulse contact solver.
+// Impulses are accumulated per contact point over several velocity iterations, then penetration is
+// removed over several position iterations. The accumulated impulses are written back to the
+// persistent contact manifolds so the next step can warm start from them.
+// With more than one thread, constraints are graph colored into batches that share no dynamic body,
+// and each batch is solved in parallel.
+class ImpulseSolver {
+public:
+
+    // Per-step buffers, in the frame arena when there is one.
+    FrameVector<ContactConstraint> constraints;
+    FrameArena* frameArena = nullptr;
+    // Contact coefficients come from the materials' pair table. Without one (outside a World) a
+    // table with only the built in materials is used.
+    const MaterialTable* materials = nullptr;
+
+    // Constraints [batchOffsets[i], batchOffsets[i + 1]) form batch i. The last batch holds the
+    // constraints that could not be colored and is always solved serially.
+    FrameVector<int> batchOffsets;
+    WorkerPool workerPool;
+
+    vector<int>& intData;
+    vector<float>& floatData;
+
+    int velocityIterations = 8;
+    int positionIterations = 3;
+
+    bool hasWarmStarting = true;
+    bool hasPenetrationResolution = true;
+    bool hasRestitution = true;
+    bool hasFriction = true;
+
+    // Stand-in record for the static terrain (TERRAIN_INDEX). It has no mass and never moves, and
+    // its material is TERRAIN_MATERIAL.
+    float terrainData[FDATA_EPO];
+
+    ImpulseSolver(vector<int>& intData, vector<float>& floatData);
+
+    void clear();
+
+    void solve(FrameVector<CollisionInfo>& collisions);
+
+    // Substepped solving (soft step). The caller integrates the bodies around these calls:
+    //   beginSubsteps; then per substep: integrate velocities, solveSubstep(true),
+    //   integrate positions, solveSubstep(false); then endSubsteps.
+    // Contacts are computed once per step and their separation is tracked from the body motion.
+    // Penetration is removed by a soft (spring-damper) bias instead of position iterations.
+    void beginSubsteps(FrameVector<CollisionInfo>& collisions, float substepTime, int substepCount);
+    void solveSubstep(bool useBias);
+    void endSubsteps();
+
+    void _prepare(FrameVector<CollisionInfo>& collisions);
+    void _colorConstraints();
+    void _warmStart();
+    void _solveVelocities(int begin, int end);
+    void _solvePositions(int begin, int end);
+    void _storeImpulses(float scale = 1.0f);
+    void _solveSoft(int begin, int end, bool useBias);
+    void _applyRestitution(int begin, int end);
+
+    // Run fn over every batch in order, in parallel within a batch.
+    void _forEachBatch(const function<void(int, int)>& fn);
+
+    void __applyImpulse(ContactConstraint& c, const Vec2& impulse);
+
+private:
+    float* _body(int index) {
+        return index == TERRAIN_INDEX ? terrainData : &floatData[index * FDATA_EPO];
+    }
+
+    int _material(int index) const {
+        return index == TERRAIN_INDEX ? TERRAIN_MATERIAL : intData[index * LIVE_INT_EPO + LIVE_INT_MATERIAL];
+    }
+
+    FrameVector<uint64_t> _bodyColors;
+    FrameVector<int> _constraintColors;
+    FrameVector<ContactConstraint> _sortedConstraints;
+
+    // Soft constraint coefficients for the current substep length.
+    int _substepCount = 1;
+    float _inverseSubstepTime = 0.0f;
+    float _biasRate = 0.0f;
+    float _massScale = 1.0f;
+    float _impulseScale = 0.0f;
+};
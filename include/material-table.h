@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.h"
+
+using namespace std;
+
+// Surface and damping coefficients shared by every object with the same material id.
+struct Material {
+    float restitution = 0.2f;
+    float staticFriction = 1.0f;
+    float kineticFriction = 1.0f;
+    float linearDamping = 0.05f;
+    float angularDamping = 0.05f;
+
+    bool operator==(const Material& other) const {
+        return restitution == other.restitution && staticFriction == other.staticFriction
+            && kineticFriction == other.kineticFriction && linearDamping == other.linearDamping
+            && angularDamping == other.angularDamping;
+    }
+};
+
+// Coefficients of a contact between two materials: the larger restitution and the smaller
+// frictions.
+struct MaterialPair {
+    float restitution;
+    float staticFriction;
+    float kineticFriction;
+};
+
+// Materials by id, with the combined coefficients of every pair precomputed, so a contact looks
+// its coefficients up instead of combining them. Ids are stable while they exist.
+// DEFAULT_MATERIAL and TERRAIN_MATERIAL always exist.
+//
+// Materials made by add are kept until the table goes. Materials made by intern, for objects'
+// own coefficients, are counted: objects acquire and release their material, and an interned
+// material goes away, freeing its id for reuse, when its last object releases it.
+class MaterialTable {
+public:
+    MaterialTable();
+
+    // Returns the new material's id, or -1 if there are MAX_MATERIALS already.
+    int add(const Material& material);
+    // Change a material, and so every object using it. Returns false if there's no such material.
+    bool set(int id, const Material& material);
+    // The id of a material with exactly these coefficients, or -1. Never the terrain's, which
+    // changes with setTerrainMaterial.
+    int find(const Material& material) const;
+    // find, or else add a material that goes away with its last object. -1 if the table is full.
+    // Acquire the id before anything else can release or reclaim it.
+    int intern(const Material& material);
+
+    void acquire(int id) { _refs[id]++; }
+    void release(int id) {
+        _refs[id]--;
+        reclaim(id);
+    }
+    // Drop an interned material no object has acquired.
+    void reclaim(int id);
+
+    bool contains(int id) const {
+        return id >= 0 && id < static_cast<int>(_materials.size()) && _state[id] != MaterialState::FREE;
+    }
+    // One past the largest id.
+    int size() const { return static_cast<int>(_materials.size()); }
+    int refCount(int id) const { return _refs[id]; }
+    const Material& get(int id) const { return _materials[id]; }
+    const MaterialPair& pair(int a, int b) const { return _pairs[a * _stride + b]; }
+
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+
+private:
+    enum class MaterialState : char { KEPT, INTERNED, FREE };
+
+    vector<Material> _materials;
+    vector<int> _refs;
+    vector<MaterialState> _state;
+    vector<int> _freeIds;
+    // _stride * _stride pairs, row a holding a's pairs. The stride doubles when a material doesn't
+    // fit, so adding rebuilds the table only that often.
+    vector<MaterialPair> _pairs;
+    int _stride = 0;
+
+    int _insert(const Material& material, MaterialState state);
+    void _updatePairs(int id);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "constants.h"
+#include "debug.h"
+
+// Everything needed to make an object, for World::makeObject. Fields left alone keep the
+// defaults objects have always had.
+struct ObjectDesc {
+    ObjectType type = ObjectType::RIGID_BODY;
+    ObjectShape shape = ObjectShape::CIRCLE;
+
+    float x = 0.0f;
+    float y = 0.0f;
+    float r = 0.0f;
+    float vx = 0.0f;
+    float vy = 0.0f;
+    float rs = 0.0f;
+
+    float mass = 0.0f; // Ignored for fixed objects. 0 makes the object immovable.
+    float gravityScale = 1.0f;
+    // The material is the one with the coefficients below (added to the world's table if there's
+    // none yet), unless material is set to the id of one in the table.
+    int material = -1;
+    float restitution = 0.2f;
+    float staticFriction = 1.0f;
+    float kineticFriction = 1.0f;
+    float linearDamping = 0.05f;
+    float angularDamping = 0.05f;
+
+    // Radius for circles. A capsule is width long overall and height thick: its radius is
+    // height / 2 and its core segment is width - height long.
+    float width = 0.0f;
+    float height = 0.0f;
+
+    // Read a JS object spec ({type, shape, x, y, mass, radius, ...}). Missing properties keep their
+    // defaults.
+    static ObjectDesc fromVal(const emscripten_val& options);
+};
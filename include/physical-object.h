@@ -12,6 +12,10 @@ class World;
 #include "world.h"
 #include "bvh.h"
 #include "constants.h"
+#include "compound.h"
+#include "object-desc.h"
+#include "material-table.h"
+#include "slot-map.h"
 
 class PhysicalObject {
 private:
@@ -33,12 +37,25 @@ public:
 
     Aabb aabb;
     TreeNode* bvhNode; 
+
+    // Child shapes, for COMPOUND objects. Owned by the object.
+    Compound* compound = nullptr;
     
     // float mass;
     World& world;
     int worldIndex = -1;
+    uint32_t handle = INVALID_HANDLE;  // The object's handle in World::objects.
     
-    PhysicalObject(World& world, int id, emscripten_val options);
+    // The world writes the object's live data. See writeLiveData.
+    PhysicalObject(World& world, int id, ObjectType type, ObjectShape shape);
+    ~PhysicalObject();
+
+    // Fill a live data record (LIVE_INT_EPO ints, FDATA_EPO floats) for a new object.
+    static void writeLiveData(int* ints, float* floats, int id, const ObjectDesc& desc, int material);
+
+    // Switch to a material like the current one but with field set to value, added to the table
+    // if there's none like it. Returns false, changing nothing, if the table is full.
+    bool _setMaterialValue(float Material::* field, float value);
 
 
     float getX() const;
@@ -58,11 +75,11 @@ public:
     void setMass(float m);
     float getInverseMass() const;
     float getDamping() const;
-    void setDamping(float d);
+    bool setDamping(float d);
     float getRotationalDamping() const;
-    void setRotationalDamping(float rd);
+    bool setRotationalDamping(float rd);
     float getRestitution() const;
-    void setRestitution(float d);
+    bool setRestitution(float d);
     float getImpulseX() const;
     void setImpulseX(float ix);
     float getImpulseY() const;
@@ -77,9 +94,17 @@ public:
     float getHeight() const;
 
     float getStaticFriction() const;
-    void setStaticFriction(float f);
+    bool setStaticFriction(float f);
     float getKineticFriction() const;
-    void setKineticFriction(float f);
+    bool setKineticFriction(float f);
+
+    // The object's id in the world's material table. The material setters above switch the object
+    // to another material rather than changing the one it shares, and return false if the table
+    // is full. setMaterial returns false if there's no such material. setCoefficients switches to
+    // the material with exactly these coefficients, added if there's none.
+    int getMaterial() const;
+    bool setMaterial(int material);
+    bool setCoefficients(const Material& coefficients);
 
     Vec2 getPosition() const;
     void setPosition(Vec2 p);
@@ -97,6 +122,15 @@ public:
 
     // Step function to update position and rotation
     bool stepMovement(float dt);
+
+    // The two halves of stepMovement, for solvers that act between them (substepping).
+    void integrateVelocity(float dt);
+    bool integratePosition(float dt);
+
+    // True if the transform was written from outside since the last integratePosition.
+    bool wasMovedExternally() const;
+    // Recompute the angle's cosine and sine, after the angle was written from outside.
+    void syncRotation();
 };
 
 
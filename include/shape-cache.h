@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "vec2.h"
+#include "constants.h"
+
+using namespace std;
+
+struct Compound;
+
+#define SHAPE_CACHE_VERTICES MAX_POLYGON_VERTICES
+
+// World space geometry of one object, rebuilt once per step after integration (only for objects
+// that moved) and shared by AABB computation and the narrow phase.
+struct ShapeCache {
+    Vec2 axisX; // Local x axis in world space (FDATA_COS, FDATA_SIN).
+    Vec2 axisY; // Local y axis in world space (-sin r, cos r).
+
+    // Polygon outline for boxes, AABBs and polygons, or the core segment of a capsule (two
+    // vertices, rounded by half the height). Empty for other round shapes.
+    // Vertices wind so that normal i belongs to the edge from vertex i to vertex i + 1.
+    int vertexCount;
+    Vec2 vertices[SHAPE_CACHE_VERTICES];
+    Vec2 normals[SHAPE_CACHE_VERTICES];
+
+    // Child shapes of a compound body, with their world space geometry. Set by World.
+    const Compound* compound;
+};
+
+// Rebuild the cache entry of the object at index from live data. Polygons read their outline from
+// the polygon pool.
+void updateShapeCache(const vector<int>& intData, const vector<float>& floatData, int index, ShapeCache& cache,
+                      const vector<float>& polygons = {});
+
+// Rebuild every entry, resizing the cache to match the live data.
+void updateShapeCaches(const vector<int>& intData, const vector<float>& floatData, vector<ShapeCache>& caches,
+                       const vector<float>& polygons = {});
+
+// Write a polygon record at offset into the pool from local vertices (x, y pairs). The winding is
+// made counter-clockwise. Returns the bounding radius, or a negative value if the outline is not
+// a convex polygon of 3 to MAX_POLYGON_VERTICES vertices.
+float writePolygonRecord(vector<float>& polygons, int offset, const vector<float>& points);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Handles are 32 bits: the slot in the low SLOT_MAP_INDEX_BITS bits and the slot's generation above.
+// Generations start at 1, so INVALID_HANDLE never refers to anything.
+#define SLOT_MAP_INDEX_BITS 20
+#define SLOT_MAP_INDEX_MASK ((1u << SLOT_MAP_INDEX_BITS) - 1)
+#define SLOT_MAP_GENERATION_MASK ((1u << (32 - SLOT_MAP_INDEX_BITS)) - 1)
+#define INVALID_HANDLE 0u
+
+// Values addressed by generation-tagged handles. Lookup is an array access and a generation check.
+// Removing a value bumps its slot's generation, so old handles to the slot stop resolving, and the
+// slot goes on a free list for reuse. A slot whose generation would wrap is retired instead, so a
+// stale handle can never resolve to a later value.
+template<typename T>
+class SlotMap {
+public:
+    static uint32_t slotOf(uint32_t handle) { return handle & SLOT_MAP_INDEX_MASK; }
+
+    // Returns INVALID_HANDLE if every slot is taken.
+    uint32_t insert(const T& value) {
+        uint32_t slot;
+        if (_freeHead >= 0) {
+            slot = static_cast<uint32_t>(_freeHead);
+            _freeHead = _slots[slot].nextFree;
+        }
+        else {
+            if (_slots.size() > SLOT_MAP_INDEX_MASK) return INVALID_HANDLE;
+            slot = static_cast<uint32_t>(_slots.size());
+            _slots.push_back(Slot{T(), 1, -1, false});
+        }
+
+        Slot& s = _slots[slot];
+        s.value = value;
+        s.alive = true;
+        s.nextFree = -1;
+        _count++;
+        return (s.generation << SLOT_MAP_INDEX_BITS) | slot;
+    }
+
+    bool remove(uint32_t handle) {
+        Slot* s = _find(handle);
+        if (!s) return false;
+
+        _release(*s, slotOf(handle));
+        return true;
+    }
+
+    T* get(uint32_t handle) {
+        Slot* s = _find(handle);
+        return s ? &s->value : nullptr;
+    }
+
+    const T* get(uint32_t handle) const {
+        return const_cast<SlotMap*>(this)->get(handle);
+    }
+
+    bool contains(uint32_t handle) const { return get(handle) != nullptr; }
+
+    size_t size() const { return _count; }
+    size_t slotCount() const { return _slots.size(); }
+    // How many more values insert can take.
+    size_t available() const { return SLOT_MAP_INDEX_MASK + 1 - _count - _retired; }
+
+    // Remove everything. Handles from before stay invalid.
+    void clear() {
+        for (size_t i = 0; i < _slots.size(); i++) {
+            if (_slots[i].alive) _release(_slots[i], static_cast<uint32_t>(i));
+        }
+    }
+
+    void reserve(size_t count) { _slots.reserve(count); }
+    // Slots are never dropped, since their generations keep old handles from resolving.
+    void shrinkToFit() { _slots.shrink_to_fit(); }
+
+    size_t bytesUsed() const { return _slots.size() * sizeof(Slot); }
+    size_t bytesReserved() const { return _slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        T value;
+        uint32_t generation;
+        int nextFree;
+        bool alive;
+    };
+
+    vector<Slot> _slots;
+    int _freeHead = -1;
+    size_t _count = 0;
+    size_t _retired = 0;
+
+    Slot* _find(uint32_t handle) {
+        uint32_t slot = slotOf(handle);
+        if (slot >= _slots.size()) return nullptr;
+
+        Slot& s = _slots[slot];
+        if (!s.alive || s.generation != handle >> SLOT_MAP_INDEX_BITS) return nullptr;
+        return &s;
+    }
+
+    void _release(Slot& s, uint32_t slot) {
+        s.value = T();
+        s.alive = false;
+        _count--;
+
+        // Every generation has been handed out. The slot keeps the last one, which no longer
+        // resolves, and is never reused.
+        if (s.generation == SLOT_MAP_GENERATION_MASK) {
+            _retired++;
+            return;
+        }
+
+        s.generation++;
+        s.nextFree = _freeHead;
+        _freeHead = static_cast<int>(slot);
+    }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "vec2.h"
+#include "aabb.h"
+
+using namespace std;
+
+// A rectangle of solid tiles, in tiles and in world space.
+struct TileRect {
+    int column;
+    int row;
+    int columns;
+    int rows;
+    Aabb bounds;
+};
+
+// Static terrain made of square tiles on a grid.
+// Solid tiles are merged into as few rectangles as possible when the map is set, so a body sliding
+// along a flat run of tiles meets one face instead of a seam per tile. Tiles are not objects: they
+// have no broad phase proxy and no live data. Bodies find the rectangles under them through the grid.
+class Tilemap {
+public:
+    int columns = 0;
+    int rows = 0;
+    float tileSize = 1.0f;
+    Vec2 origin; // World position of the min corner of tile (0, 0).
+
+    vector<unsigned char> solid; // Per tile, row major.
+    vector<int> cellRects; // Per tile, the merged rectangle covering it, or -1.
+    vector<TileRect> rects;
+
+    // Replace the map. tiles holds columns * rows values, row major, nonzero for solid tiles.
+    // Returns false (and leaves the map as it was) if the sizes don't match.
+    bool set(int columns, int rows, float tileSize, const Vec2& origin, const vector<int>& tiles);
+    void clear();
+    bool empty() const { return rects.empty(); }
+
+    bool isSolid(int column, int row) const {
+        return column >= 0 && column < columns && row >= 0 && row < rows && solid[row * columns + column];
+    }
+    bool isSolidAt(const Vec2& point) const {
+        return isSolid(static_cast<int>(floor((point.x - origin.x) / tileSize)),
+                       static_cast<int>(floor((point.y - origin.y) / tileSize)));
+    }
+
+    // Call fn(rectIndex) once for every merged rectangle with a tile under bounds.
+    template<typename F>
+    void query(const Aabb& bounds, F fn) const {
+        if (rects.empty()) return;
+
+        int minColumn = max(0, static_cast<int>(floor((bounds.min.x - origin.x) / tileSize)));
+        int minRow = max(0, static_cast<int>(floor((bounds.min.y - origin.y) / tileSize)));
+        int maxColumn = min(columns - 1, static_cast<int>(floor((bounds.max.x - origin.x) / tileSize)));
+        int maxRow = min(rows - 1, static_cast<int>(floor((bounds.max.y - origin.y) / tileSize)));
+
+        for (int row = minRow; row <= maxRow; row++) {
+            for (int column = minColumn; column <= maxColumn; column++) {
+                int rect = cellRects[row * columns + column];
+                if (rect < 0) continue;
+
+                // Report each rectangle from the first of its tiles inside the range only.
+                const TileRect& r = rects[rect];
+                if (column == max(r.column, minColumn) && row == max(r.row, minRow)) fn(rect);
+            }
+        }
+    }
+};
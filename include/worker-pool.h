@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A small pool of persistent worker threads for data-parallel loops.
+// Without thread support (e.g. a WASM build without pthreads), everything runs on the calling thread.
+class WorkerPool {
+public:
+
+    // Ranges smaller than this are not worth waking the workers for.
+    int minParallelCount = 128;
+
+    WorkerPool();
+    ~WorkerPool();
+
+    // Total threads used by parallelFor, including the calling thread.
+    void setThreadCount(int count);
+    int getThreadCount() const;
+
+    // Calls fn(begin, end) on disjoint chunks covering [0, count). Blocks until all chunks are done.
+    void parallelFor(int count, const function<void(int, int)>& fn);
+
+private:
+    vector<thread> _workers;
+
+    mutex _mutex;
+    condition_variable _workAvailable;
+    condition_variable _workDone;
+
+    const function<void(int, int)>* _task = nullptr;
+    int _taskCount = 0;
+    int _chunkSize = 0;
+    int _pending = 0;
+    int _generation = 0;
+    bool _stopping = false;
+
+    void _workerLoop(int workerIndex, int seenGeneration);
+    void _stopWorkers();
+};
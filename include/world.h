@@ -12,34 +12,122 @@
 #include "vec2.h"
 #include "bvh.h"
 #include "collision-solver.h"
+#include "shape-cache.h"
 #include "physical-object.h"
 #include "impulse-solver.h"
+#include "tilemap.h"
+#include "slot-map.h"
+#include "object-desc.h"
+#include "frame-arena.h"
 #include "constants.h"
 
 
 class PhysicalObject;  // Forward declaration of PhysicalObject
 
+// Overlap state of a broad phase pair with a sensor in it.
+struct SensorPair {
+    int stamp; // Last narrow phase the pair was a broad phase pair.
+    int idA;
+    int idB;
+    bool sensorA;
+    bool sensorB;
+    bool overlapping;
+};
+
+// Heap memory of one part of the world, in bytes. used is what its live contents take, reserved
+// what it holds on to (capacity, free lists and pools included), and highWater the most it has
+// used since the world was made or last compacted. Hash maps are estimated from their sizes.
+struct SubsystemMemory {
+    size_t used = 0;
+    size_t reserved = 0;
+    size_t highWater = 0;
+};
+
+struct MemoryStats {
+    SubsystemMemory objects;     // Per-object buffers, the objects themselves and the slot map.
+    SubsystemMemory bvh;         // Tree nodes.
+    SubsystemMemory contacts;    // Manifolds, SAT and pair caches, sensor pairs, material pairs.
+    SubsystemMemory frameArena;  // Per-step buffers.
+    SubsystemMemory lookup;      // Handles by id.
+    SubsystemMemory events;      // Collision and sensor event buffers.
+    SubsystemMemory staging;     // makeObjects staging buffers.
+    SubsystemMemory shapes;      // Polygon records and the tilemap.
+    SubsystemMemory total;
+};
+
 class World {
 private:
 
-    std::unordered_map<int, PhysicalObject*> objectsMap;  // Stores objects by their ID
-    std::vector<PhysicalObject*> objectsList;             // List for efficient iteration
+    SlotMap<PhysicalObject*> objects;                     // Stores objects by their handle
+    std::unordered_map<int, uint32_t> handlesById;        // For the id based functions
+    std::vector<PhysicalObject*> objectsList;             // List for efficient iteration, parallel to the live data
+    std::vector<int> pendingRemovals;                     // Indices of removed objects, reused or compacted on the next step
+    std::vector<PhysicalObject*> objectPool;              // Destroyed objects, kept as memory for new ones
+    std::vector<std::unordered_map<int, uint32_t>::node_type> idNodePool;  // Unlinked handlesById entries
+    FrameArena frameArena;                                // Per-step buffers of the BVH and the solvers. Reset by each step
 	Bvh bvh;
     CollisionSolver collisionSolver;
+    ImpulseSolver impulseSolver;
     // std::vector<int> ids;
 
 	float timeStep = 1.0f / 60.0f;  // Default time step of 60 Hz
+    float accumulator = 0.0f;  // Unsimulated time carried between advance calls.
+    int substeps = 1;  // Solver substeps per step. 1 uses the regular iterative solver.
 
 	Vec2 gravity = Vec2(0.0f, 0.0f);  // Default gravity vector
 
-    bool hasPenetrationResolution = true;
-    bool hasRestitution = true;
-    bool hasFriction = true;
-
 public:
 
 	std::vector<float> liveFloatData;  // x1, y1, r1, xs1, ys1, rs1, mass, fx, fy, ix, iy  x2, ...
 	std::vector<int> liveIntData;  // id, shape, type, hasaabbcollision
+    std::vector<ShapeCache> shapeCache;  // World space axes and outlines, parallel to the live data.
+
+    // Index of each handle's object in the live data, by slot (handle & SLOT_MAP_INDEX_MASK), or -1.
+    // Removal leaves holes in the live data until the next step compacts them, and this is the only
+    // table that changes when it does.
+    std::vector<int> slotIndices;
+
+    std::vector<float> polygonData;  // Polygon records, POLYGON_RECORD_SIZE floats each.
+    std::vector<int> freePolygonRecords;  // Offsets of records released by removed objects.
+
+    MaterialTable materials;  // Restitution, friction and damping, by the material id in the live int data.
+
+    Tilemap tilemap;  // Static terrain. Not part of the objects, the BVH or the live data.
+
+    std::vector<float> previousTransforms;  // x, y, r before the last step.
+    std::vector<float> renderData;  // x, y, r blended between the last two steps.
+
+    // Collision events: begin, persist and end records of the contacts of the last step, or of all
+    // steps of the last advance call. See EVENT_* for the layout.
+    std::vector<int> eventIntData;  // Event count, then type, idA, idB per event.
+    std::vector<float> eventFloatData;  // nx, ny, impulse, px, py per event.
+
+    // Sensors skip contact generation and resolution. Their pairs only track overlap, and are only
+    // tested again when one of the objects moved. Changes go to the enter and exit lists.
+    // Pairs aren't tracked incrementally: every step looks up each broad phase sensor pair here
+    // and scans the map for the ones that left, so the cost still grows with the number of objects
+    // inside sensors, even when nothing enters or exits.
+    std::unordered_map<uint64_t, SensorPair> sensorPairs;
+    std::unordered_map<int, std::vector<int>> sensorOverlaps;  // Ids overlapping each sensor, by sensor id.
+    std::vector<int> sensorEnterData;  // Count, then sensor id, other id per record.
+    std::vector<int> sensorExitData;
+    int sensorStamp = 0;
+
+    // Staging buffers for makeObjects, filled by JS.
+    std::vector<float> stagingFloatData;
+    std::vector<int> stagingIntData;
+    std::vector<uint32_t> stagingHandles;
+
+    std::vector<float> queuedForces;  // nfx, nfy, reapplied on every substep.
+    std::vector<char> movedInStep;  // Moved (or was created) since the last narrow phase.
+
+    // Every per-object buffer (live data, render data, slot indices, ...) is reserved for
+    // objectCapacity objects, so views of them stay valid until the capacity grows. Growing
+    // reallocates them all and bumps bufferGeneration, which tells JS to fetch new views.
+    size_t objectCapacity = 0;
+    uint32_t bufferGeneration = 0;
+
+    MemoryStats memoryStats;  // Last sample, with the high-water marks.
 
     std::unordered_map<int, float> decayMap;  // Stores precomputed decay rates by decay percentage per second.
 
@@ -50,43 +138,138 @@ public:
     ~World();
 
     // Make a new object to the world (ownership transferred to World)
-    // Returns the index of the new object
-    int makeObject(int id, emscripten_val options);
+    // Returns the handle of the new object, or INVALID_HANDLE if no more handles are left, the
+    // material table is full, or desc.material isn't in it
+    uint32_t makeObject(int id, const ObjectDesc& desc);
+    // Same, from a JS object spec. See ObjectDesc::fromVal.
+    uint32_t makeObject(int id, emscripten_val options);
     // void addObject(PhysicalObject* object);
 
-    // Remove an object from the world by its ID
-    int removeObject(int id);
+    // Bulk creation. Fill the first count records of the staging buffers in the live data layout,
+    // then call makeObjects(count) to append them all at once. Only the inputs are read: id, shape,
+    // type and material, and x through height in the float data. Returns the number of objects
+    // made (0 if count is more than the staging capacity or than the handles left, or a material
+    // isn't in the table), and leaves their handles in stagingHandles.
+    // Changing the staging capacity reallocates the staging buffers.
+    void setStagingCapacity(int count);
+    int getStagingCapacity() const;
+    int makeObjects(int count);
+
+    // Remove an object from the world by its ID or handle. Its live data record becomes a hole,
+    // which the next object made takes over, or else the next step fills by moving the last
+    // records down. The object's memory, BVH nodes and id entry are kept for reuse. Returns false
+    // if there's no such object.
+    bool removeObject(int id);
+    bool removeObjectByHandle(uint32_t handle);
+
+    // Make the object a convex polygon with the given local vertices (x, y pairs, either winding).
+    // Returns false if the object doesn't exist or the outline is not a convex polygon of 3 to
+    // MAX_POLYGON_VERTICES vertices.
+    bool setPolygon(int id, const std::vector<float>& points);
+
+    // Make the object a compound of child shapes (COMPOUND_CHILD_EPO floats each: shape, x, y, r,
+    // width or radius, height, mass). The object takes the children's total mass and moves to their
+    // center of mass. Returns false if the object doesn't exist or a child is not a CIRCLE or BOX.
+    bool setCompound(int id, const std::vector<float>& children);
+
+    // Replace the static terrain with a grid of square tiles. tiles holds columns * rows values, row
+    // major from the tile at (x, y), nonzero for solid tiles. Returns false if the sizes don't match.
+    bool setTilemap(int columns, int rows, float tileSize, float x, float y, const std::vector<int>& tiles);
+    void setTerrainMaterial(float restitution, float staticFriction, float kineticFriction);
+
+    // Materials shared by objects through their material id. addMaterial returns the new id, or
+    // -1 if the table is full. setMaterial changes every object using the material.
+    // setObjectCoefficients moves an object to the material with exactly these coefficients.
+    // Returns false if there's no such material (or object), or the table is full.
+    int addMaterial(float restitution, float staticFriction, float kineticFriction, float linearDamping, float angularDamping);
+    bool setMaterial(int material, float restitution, float staticFriction, float kineticFriction, float linearDamping, float angularDamping);
+    bool setObjectMaterial(int id, int material);
+    bool setObjectCoefficients(int id, const Material& coefficients);
 
     void setTimeStep(float dt);
 
     void setHasPenetrationResolution(bool value);
     void setHasRestitution(bool value);
     void setHasFriction(bool value);
+    void setHasWarmStarting(bool value);
+
+    void setVelocityIterations(int iterations);
+    void setPositionIterations(int iterations);
+    void setThreadCount(int count);
+    void setSubsteps(int count);
 
     void setGravity(float x, float y);
 
     int findeIndexForObject(int id);
     // Access an object by its ID
     PhysicalObject* getObject(int id) const;
+    PhysicalObject* getObjectByHandle(uint32_t handle) const;
 
 	PhysicalObject* getObjectAtIndex(int index) const;
 
     int getObjectCount() const;
 
+    // Make room for count objects without reallocating. Only grows.
+    void reserveObjects(int count);
+    int getObjectCapacity() const;
+    uint32_t getBufferGeneration() const;
+
+    // Memory used and reserved by each subsystem. Sampled after every step and by this call.
+    MemoryStats getMemoryStats();
+    // Give back memory that outgrew the scene: shrink the per-object buffers to the objects there
+    // are (bumping bufferGeneration, like growing does), free the object, node and id pools, fit
+    // the caches and event buffers to their contents, and size the frame arena to the next step.
+    // Resets the high-water marks.
+    void compact();
+
+    // Ids of the objects overlapping a sensor.
+    std::vector<int> getSensorOverlaps(int id) const;
+
 #ifdef EMSCRIPTEN
 	emscripten_val getLiveFloatData();
 	emscripten_val getLiveIntData();
+	emscripten_val getRenderData();
+	emscripten_val getSlotIndices();
+	emscripten_val getStagingFloatData();
+	emscripten_val getStagingIntData();
+	emscripten_val getStagingHandles();
+	emscripten_val getEventIntData();
+	emscripten_val getEventFloatData();
+	emscripten_val getSensorEnterData();
+	emscripten_val getSensorExitData();
 #endif
 
+    // Run as many fixed steps as fit in the elapsed time (at most maxSteps), then publish
+    // interpolated transforms into renderData. Returns the number of steps taken.
+    int advance(float elapsedSeconds, int maxSteps);
+    float getInterpolationAlpha() const;
+    void _storePreviousTransforms();
+    void _publishRenderData();
+
     // Step function to update all objects in the world
     void step();
+    void _doStep();
+    void _flushRemovals();
+    int _claimRecord();
+    void _resizeRecords(size_t count);
+    PhysicalObject* _acquireObject(int id, ObjectType type, ObjectShape shape);
+    void _releaseObject(PhysicalObject* object);
+    void _releasePools();
+    void _setObjectCapacity(size_t capacity);
+    void _sampleMemory();
+    bool _registerObject(PhysicalObject* object, int index);
+    void _clearEvents();
+    void _publishEvents();
     void _doKinematics();
     void _doBroadPhase();
     void _doNarrowPhase();
+    void _doTerrain();
+    void _updateSensorPair(int indexA, int indexB);
+    void _endSensorPairs();
+    void _setSensorOverlap(SensorPair& pair, bool overlapping);
     void _doResolution();
-    void __doPenetrationResolution(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject* objB);
-    void __doRestitution(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject* objB);
-    void __doCollisionFriction(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject* objB);
+    void _doSubsteps();
+    void _updateShape(PhysicalObject* object);
 
 	void clear();
 
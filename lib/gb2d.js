@@ -1,13 +1,19 @@
 
 import gb2dModule from './build/gb2d-module.js';
 
-const SIZE_I = 4;
-const SIZE_F = 28;
+const SIZE_I = 6;
+const SIZE_F = 25;
 
 const ID_OFFSET = 0;
 const SHAPE_OFFSET = 1;
 const TYPE_OFFSET = 2;
 const HAS_COLLISION_OFFSET = 3;
+const SHAPE_DATA_OFFSET = 4; // Polygon record offset, or -1.
+const MATERIAL_OFFSET = 5; // Id in the material table.
+
+// Materials always in the table.
+const DEFAULT_MATERIAL = 0;
+const TERRAIN_MATERIAL = 1;
 
 const X_OFFSET = 0;
 const Y_OFFSET = 1;
@@ -19,27 +25,50 @@ const MASS_OFFSET = 6;
 const INV_MASS_OFFSET = 7;
 
 const G_SCALE_OFFSET = 8 // How much gravity affects this object.
-const RESTITUTION_OFFSET = 9 // Bounciness
-const S_FRICTION_OFFSET = 10 // Static friction
-const K_FRICTION_OFFSET = 11 // Kinetic friction
-const DAMPING_OFFSET = 12 // Linear damping (air resistance)
-const ANGULAR_DAMPING_OFFSET = 13 // Angular damping
-
-const RADIUS_OFFSET = 14;
-const WIDTH_OFFSET = 14;
-const HEIGHT_OFFSET = 15;
-const FX_OFFSET = 16;
-const FY_OFFSET = 17;
-const IX_OFFSET = 18;
-const IY_OFFSET = 19;
-const AX1_OFFSET = 20;
-const AY1_OFFSET = 21;
-const AX2_OFFSET = 22;
-const AY2_OFFSET = 23;
-const NFX_OFFSET = 24;
-const NFY_OFFSET = 25;
-const NIX_OFFSET = 26;
-const NIY_OFFSET = 27;
+
+const RADIUS_OFFSET = 9;
+const WIDTH_OFFSET = 9;
+const HEIGHT_OFFSET = 10;
+const FX_OFFSET = 11;
+const FY_OFFSET = 12;
+const IX_OFFSET = 13;
+const IY_OFFSET = 14;
+const AX1_OFFSET = 15;
+const AY1_OFFSET = 16;
+const AX2_OFFSET = 17;
+const AY2_OFFSET = 18;
+const NFX_OFFSET = 19;
+const NFY_OFFSET = 20;
+const NIX_OFFSET = 21;
+const NIY_OFFSET = 22;
+const COS_OFFSET = 23; // Rotation as a unit complex number, kept in sync with R.
+const SIN_OFFSET = 24;
+
+// Interpolated render transforms.
+const SIZE_R = 3;
+const RENDER_X_OFFSET = 0;
+const RENDER_Y_OFFSET = 1;
+const RENDER_R_OFFSET = 2;
+
+// Collision events. The int buffer starts with the event count.
+const EVENT_HEADER = 1;
+const EVENT_SIZE_I = 3;
+const EVENT_TYPE_OFFSET = 0;
+const EVENT_ID_A_OFFSET = 1;
+const EVENT_ID_B_OFFSET = 2;
+const EVENT_SIZE_F = 5;
+const EVENT_NX_OFFSET = 0;
+const EVENT_NY_OFFSET = 1;
+const EVENT_IMPULSE_OFFSET = 2;
+const EVENT_PX_OFFSET = 3;
+const EVENT_PY_OFFSET = 4;
+
+// Sensor enter and exit lists. Each starts with its record count.
+const SENSOR_EVENT_HEADER = 1;
+const SENSOR_EVENT_SIZE = 2;
+
+// Handles hold the object's slot in their low bits. getSlotIndices maps each slot to its index.
+const SLOT_INDEX_MASK = (1 << 20) - 1;
 
 const ANIMSCALE = 100;
 
@@ -47,8 +76,8 @@ class World {
 	constructor(WorldConstructor){
 		this.world = new WorldConstructor();
 		// this.ids = this.world.getIds();
-		this.liveFloatData = this.world.getLiveFloatData();
-		this.liveIntData = this.world.getLiveIntData();
+		this.bufferGeneration = -1;
+		this.refreshViews();
 		/**
 		 * @type {Record<number, PhysicalObject>}
 		 */
@@ -68,32 +97,181 @@ class World {
 		}
 	}
 
+	/**
+	 * Fetch new views of the live data if the engine reallocated it (it grows as objects are added)
+	 * or if wasm memory grew, which detaches every view. Cheap when nothing changed.
+	 */
+	refreshViews(){
+		let generation = this.world.getBufferGeneration();
+		if(generation === this.bufferGeneration && this.liveFloatData.length !== 0) return;
+
+		this.bufferGeneration = generation;
+		this.liveFloatData = this.world.getLiveFloatData();
+		this.liveIntData = this.world.getLiveIntData();
+		this.renderData = this.world.getRenderData();
+		this.slotIndices = this.world.getSlotIndices();
+	}
+	// Make room for count objects up front, so adding them doesn't reallocate the live data.
+	reserveObjects(count){
+		this.world.reserveObjects(count);
+		this.refreshViews();
+	}
+	/**
+	 * Bytes used, reserved and at most used (highWater) by each part of the engine: objects, bvh,
+	 * contacts, frameArena, lookup, events, staging and shapes, and the total.
+	 */
+	getMemoryStats(){
+		return this.world.getMemoryStats();
+	}
+	/**
+	 * Give back memory the scene no longer needs, e.g. after removing most objects. Views of the
+	 * live data are refreshed.
+	 */
+	compact(){
+		this.world.compact();
+		this.refreshViews();
+	}
+
 	step(){
 		// console.log("STEP");
 		// this.liveFloatData[2] += 0.1;
-		return this.world.step();
+		let result = this.world.step();
+		this.refreshViews();
+		return result;
+	}
+	/**
+	 * Run as many fixed steps as fit in the elapsed time and update the interpolated render transforms.
+	 * Returns the number of steps taken.
+	 */
+	advance(elapsedSeconds, maxSteps = 5){
+		let steps = this.world.advance(elapsedSeconds, maxSteps);
+		this.refreshViews();
+		return steps;
+	}
+	getInterpolationAlpha(){
+		return this.world.getInterpolationAlpha();
 	}
 	clear(){
 		this.objectsById = {};
 		this.objectCount = 0;
 		return this.world.clear();
 	}
+	/**
+	 * Call cb(type, idA, idB, nx, ny, impulse, px, py) for each collision event of the last step or
+	 * advance call. type is gb2d.COLLISION_BEGIN, COLLISION_PERSIST or COLLISION_END. The normal points
+	 * from A to B. idB is gb2d.TERRAIN_ID for contacts with the tilemap.
+	 */
+	readEvents(cb){
+		// The buffers may move between steps, so the views are taken fresh.
+		let ints = this.world.getEventIntData();
+		let floats = this.world.getEventFloatData();
+		let count = ints[0];
+		for(let i = 0; i < count; i++){
+			let iI = EVENT_HEADER + i * EVENT_SIZE_I;
+			let iF = i * EVENT_SIZE_F;
+			cb(
+				ints[iI + EVENT_TYPE_OFFSET], ints[iI + EVENT_ID_A_OFFSET], ints[iI + EVENT_ID_B_OFFSET],
+				floats[iF + EVENT_NX_OFFSET], floats[iF + EVENT_NY_OFFSET], floats[iF + EVENT_IMPULSE_OFFSET],
+				floats[iF + EVENT_PX_OFFSET], floats[iF + EVENT_PY_OFFSET]
+			);
+		}
+		return count;
+	}
+	/**
+	 * Call onEnter(sensorId, otherId) and onExit(sensorId, otherId) for the sensor overlaps that
+	 * started and ended in the last step or advance call. Exits are reported first.
+	 */
+	readSensorEvents(onEnter, onExit){
+		let lists = [[this.world.getSensorExitData(), onExit], [this.world.getSensorEnterData(), onEnter]];
+		for(let [data, cb] of lists){
+			if(!cb) continue;
+			for(let i = 0; i < data[0]; i++){
+				let offset = SENSOR_EVENT_HEADER + i * SENSOR_EVENT_SIZE;
+				cb(data[offset], data[offset + 1]);
+			}
+		}
+	}
+	/**
+	 * Ids of the objects currently overlapping a sensor.
+	 */
+	getSensorOverlaps(id){
+		let overlaps = this.world.getSensorOverlaps(id);
+		let ids = [];
+		for(let i = 0; i < overlaps.size(); i++) ids.push(overlaps.get(i));
+		overlaps.delete();
+		return ids;
+	}
 	setGravity(x, y){
 		this.world.setGravity(x,y);
 	}
 	makeObject(id, spec){
 		if(this.objectsById[id]) return null;
 
-		this.objectCount++;
-
 		// console.log("MAKE OBJECT");
 
-		let index = this.world.makeObject(id, spec);
-		let obj = new PhysicalObject(index, this.world, this.liveFloatData, this.liveIntData);
+		let handle = this.world.makeObject(id, spec);
+		if(handle === 0) throw new Error(`Can't make object ${id}: out of handles or materials, or no such material.`);
+		this.objectCount++;
+		this.refreshViews();
+		let obj = new PhysicalObject(handle, this.world, this);
 		this.objectsById[id] = obj;
 		return obj;
 	
 	}
+	/**
+	 * Make many objects at once. specs is a list of the same specs makeObject takes, each with its id.
+	 * The specs are packed into the engine's staging buffers and added in one call, which is much
+	 * faster than one makeObject per object. Specs with an id that's taken are skipped. Returns the
+	 * new objects. Throws, making none, if there aren't enough handles or a material is missing.
+	 */
+	makeObjects(specs){
+		specs = specs.filter(spec => !this.objectsById[spec.id]);
+		let count = specs.length;
+		if(count === 0) return [];
+
+		if(this.world.getStagingCapacity() < count){
+			this.world.setStagingCapacity(Math.max(count, this.world.getStagingCapacity() * 2));
+		}
+		// The staging views are detached by memory growth as well as by the capacity change.
+		let ints = this.world.getStagingIntData();
+		let floats = this.world.getStagingFloatData();
+		// Specs without a material id share the material with their coefficients.
+		let materials = new Map();
+
+		for(let i = 0; i < count; i++){
+			let spec = specs[i];
+			let iI = i * SIZE_I;
+			let iF = i * SIZE_F;
+			ints[iI + ID_OFFSET] = spec.id;
+			ints[iI + SHAPE_OFFSET] = spec.shape ?? 1;
+			ints[iI + TYPE_OFFSET] = spec.type ?? 0;
+			ints[iI + MATERIAL_OFFSET] = spec.material ?? this._internMaterial(spec, materials);
+
+			floats[iF + X_OFFSET] = spec.x ?? 0;
+			floats[iF + Y_OFFSET] = spec.y ?? 0;
+			floats[iF + R_OFFSET] = spec.r ?? 0;
+			floats[iF + VX_OFFSET] = spec.vx ?? 0;
+			floats[iF + VY_OFFSET] = spec.vy ?? 0;
+			floats[iF + RS_OFFSET] = spec.rs ?? 0;
+			floats[iF + MASS_OFFSET] = spec.mass ?? 0;
+			floats[iF + G_SCALE_OFFSET] = spec.gscale ?? 1;
+			floats[iF + RADIUS_OFFSET] = spec.radius ?? spec.width ?? 0;
+			floats[iF + HEIGHT_OFFSET] = spec.height ?? 0;
+		}
+
+		if(this.world.makeObjects(count) === 0) throw new Error("Can't make objects: out of handles, or no such material.");
+		this.refreshViews();
+
+		let handles = this.world.getStagingHandles();
+		let objects = [];
+		for(let i = 0; i < count; i++){
+			let obj = new PhysicalObject(handles[i], this.world, this);
+			this.objectsById[obj.id] = obj;
+			objects.push(obj);
+		}
+		this.objectCount += count;
+		return objects;
+	}
 	removeObject(id){
 		// console.log("REMOVE OBJECT");
 
@@ -103,27 +281,101 @@ class World {
 			return false;
 		}
 		else {
-			// To delete an object, call world.removeObject. This will return the index.
-			// Then read the index, it will contain the ID of the object from the end of the vector
-			// which replaced the deleted item. 
-			// Then, update the index of the object that replaced the deleted object within our model.
+			// Objects find their index through their handle, so nothing else needs fixing up here.
 			delete this.objectsById[id];
-			let deletedIndex = this.world.removeObject(id);
-			// console.debug(`Removing from index ${deletedIndex}.`);
-			let replacedId = this.liveIntData[deletedIndex * SIZE_I + ID_OFFSET];
-			// console.debug(`Replacing with #${replacedId}.`);
-			if(replacedId != id){
-				// Happens when we delete the last object in the list.
-				let replacedObj = this.objectsById[replacedId];
-				replacedObj.index = deletedIndex;
-			}
+			this.world.removeObject(id);
 			this.objectCount--;
 		}
 	}
 
+	/**
+	 * Make the object a convex polygon. points holds up to 8 local vertices as [x0, y0, x1, y1, ...].
+	 * Returns false if the outline is not convex.
+	 */
+	setPolygon(id, points){
+		let result = this.world.setPolygon(id, points);
+		this.refreshViews();
+		return result;
+	}
+
+	/**
+	 * Make the object a compound body. children is a list of {shape, x, y, r, width, height, radius, mass}
+	 * with shape gb2d.CIRCLE or gb2d.BOX, positioned relative to the object. The object takes their
+	 * total mass and moves to their center of mass.
+	 */
+	setCompound(id, children){
+		let data = [];
+		for(let child of children){
+			let size = child.shape === gb2d.CIRCLE ? (child.radius || 0) : (child.width || 0);
+			data.push(child.shape, child.x || 0, child.y || 0, child.r || 0, size, child.height || 0, child.mass || 0);
+		}
+		let result = this.world.setCompound(id, data);
+		this.refreshViews();
+		return result;
+	}
+
+	/**
+	 * Replace the static terrain with a grid of square tiles. tiles holds columns * rows values, row by
+	 * row from the tile at (x, y), nonzero for solid tiles. Tiles are not objects: they get no id and
+	 * don't appear in the live data. Returns false if the sizes don't match.
+	 */
+	setTilemap(columns, rows, tileSize, x, y, tiles){
+		let result = this.world.setTilemap(columns, rows, tileSize, x, y, tiles);
+		this.refreshViews();
+		return result;
+	}
+	setTerrainMaterial(restitution, sFriction, kFriction){
+		this.world.setTerrainMaterial(restitution, sFriction, kFriction);
+	}
+	/**
+	 * Materials are shared by every object with their id. spec has restitution, sFriction, kFriction,
+	 * linearDamping and angularDamping, and missing values take the defaults. addMaterial returns the
+	 * new id, or -1 if the table is full. setMaterial changes every object using the material.
+	 */
+	addMaterial(spec = {}){
+		let m = this._materialValues(spec);
+		return this.world.addMaterial(m.restitution, m.sFriction, m.kFriction, m.linearDamping, m.angularDamping);
+	}
+	setMaterial(material, spec = {}){
+		let m = this._materialValues(spec);
+		return this.world.setMaterial(material, m.restitution, m.sFriction, m.kFriction, m.linearDamping, m.angularDamping);
+	}
+	getMaterial(material){
+		return this.world.getMaterial(material);
+	}
+	_materialValues(spec){
+		return {
+			restitution: spec.restitution ?? 0.2,
+			sFriction: spec.sFriction ?? 1,
+			kFriction: spec.kFriction ?? 1,
+			linearDamping: spec.linearDamping ?? 0.05,
+			angularDamping: spec.angularDamping ?? 0.05,
+		};
+	}
+	// The id of the material with a spec's coefficients, added if there's none. cache maps the
+	// coefficients to ids already found.
+	_internMaterial(spec, cache){
+		let m = this._materialValues(spec);
+		let key = `${m.restitution},${m.sFriction},${m.kFriction},${m.linearDamping},${m.angularDamping}`;
+		let id = cache?.get(key);
+		if(id === undefined){
+			id = this.world.internMaterial(m);
+			if(id < 0) throw new Error("Material table is full.");
+			cache?.set(key, id);
+		}
+		return id;
+	}
+
 	setHasPenetrationResolution(value){ this.world.setHasPenetrationResolution(value); }
 	setHasRestitution(value){ this.world.setHasRestitution(value); }
 	setHasFriction(value){ this.world.setHasFriction(value); }
+	setHasWarmStarting(value){ this.world.setHasWarmStarting(value); }
+	setVelocityIterations(value){ this.world.setVelocityIterations(value); }
+	setPositionIterations(value){ this.world.setPositionIterations(value); }
+	// Only has an effect in builds with thread support.
+	setThreadCount(value){ this.world.setThreadCount(value); }
+	// Solver substeps per step, for stable results at low step rates. 1 disables substepping.
+	setSubsteps(value){ this.world.setSubsteps(value); }
 };
 
 // There's a way to make this work.
@@ -131,14 +383,23 @@ class World {
 // Thing is, this probably isn't something that needs to happen on each frame, and certainly not on each data read.
 // I bet there's a way to just mark the object as "dirty".
 class PhysicalObject{
-	constructor(index, world, liveFData, liveIData){
-		this.id = liveIData[index * SIZE_I + ID_OFFSET];
-		this.liveFData = liveFData;
-		this.liveIData = liveIData;
-		this.index = index;
+	// views is the World wrapper, which swaps in new views of the live data when it reallocates.
+	constructor(handle, world, views){
+		this.handle = handle;
+		this.views = views;
 		this.world = world;
+		this.id = this.liveIData[this.index * SIZE_I + ID_OFFSET];
 	}
 
+	get liveFData() { return this.views.liveFloatData; }
+	get liveIData() { return this.views.liveIntData; }
+	get renderData() { return this.views.renderData; }
+	get slotIndices() { return this.views.slotIndices; }
+
+	// Removals are compacted at the start of a step, which moves objects, so the index is looked up
+	// through the handle's slot every time.
+	get index() { return this.slotIndices[this.handle & SLOT_INDEX_MASK]; }
+
     get shape() { return this.liveIData[this.index * SIZE_I + SHAPE_OFFSET]; }
     set shape(v) { this.liveIData[this.index * SIZE_I + SHAPE_OFFSET] = v; }
 
@@ -152,7 +413,16 @@ class PhysicalObject{
     set y(v) { this.liveFData[this.index * SIZE_F + Y_OFFSET] = v; }
     
     get r() { return this.liveFData[this.index * SIZE_F + R_OFFSET]; }
-    set r(v) { this.liveFData[this.index * SIZE_F + R_OFFSET] = v; }
+    set r(v) {
+		this.liveFData[this.index * SIZE_F + R_OFFSET] = v;
+		this.liveFData[this.index * SIZE_F + COS_OFFSET] = Math.cos(v);
+		this.liveFData[this.index * SIZE_F + SIN_OFFSET] = Math.sin(v);
+	}
+
+    // Interpolated transforms, valid after World.advance.
+    get renderX() { return this.renderData[this.index * SIZE_R + RENDER_X_OFFSET]; }
+    get renderY() { return this.renderData[this.index * SIZE_R + RENDER_Y_OFFSET]; }
+    get renderR() { return this.renderData[this.index * SIZE_R + RENDER_R_OFFSET]; }
     
     get vx() { return this.liveFData[this.index * SIZE_F + VX_OFFSET]; }
     set vx(v) { this.liveFData[this.index * SIZE_F + VX_OFFSET] = v; }
@@ -206,28 +476,36 @@ class PhysicalObject{
     
 	get hasCollisionFlags() { return this.liveIData[this.index * SIZE_I + HAS_COLLISION_OFFSET]; }
 
-	// G_SCALE_OFFSET
-	// RESTITUTION_OFFSET
-	// S_FRICTION_OFFSET
-	// D_FRICTION_OFFSET
-	// K_FRICTION_OFFSET
-	// DAMPING_OFFSET
-	// ANGULAR_DAMPING_OFFSET
-
 	get gScale() { return this.liveFData[this.index * SIZE_F + G_SCALE_OFFSET]; }
 	set gScale(v) { this.liveFData[this.index * SIZE_F + G_SCALE_OFFSET] = v; }
 
-	get restitution() { return this.liveFData[this.index * SIZE_F + RESTITUTION_OFFSET]; }
-	set restitution(v) { this.liveFData[this.index * SIZE_F + RESTITUTION_OFFSET] = v; }
-	
-	get staticFriction() { return this.liveFData[this.index * SIZE_F + S_FRICTION_OFFSET]; }
-	set staticFriction(v) { this.liveFData[this.index * SIZE_F + S_FRICTION_OFFSET] = v; }
-	
-	// get dynamicFriction() { return this.liveFData[this.index * SIZE_F + D_FRICTION_OFFSET]; }
-	// set dynamicFriction(v) { this.liveFData[this.index * SIZE_F + D_FRICTION_OFFSET] = v; }
-	
-	get kineticFriction() { return this.liveFData[this.index * SIZE_F + F_FRICTION_OFFSET]; }
-	set kineticFriction(v) { this.liveFData[this.index * SIZE_F + F_FRICTION_OFFSET] = v; }
+	// Restitution, friction and damping belong to the object's material. Setting one of them moves
+	// the object to the material with the new value, and leaves other objects alone.
+	get material() { return this.liveIData[this.index * SIZE_I + MATERIAL_OFFSET]; }
+	set material(v) {
+		if(!this.world.setObjectMaterial(this.id, v)) throw new Error(`No material ${v}.`);
+	}
+
+	get restitution() { return this.world.getMaterial(this.material).restitution; }
+	set restitution(v) { this._setMaterialValue('restitution', v); }
+
+	get staticFriction() { return this.world.getMaterial(this.material).sFriction; }
+	set staticFriction(v) { this._setMaterialValue('sFriction', v); }
+
+	get kineticFriction() { return this.world.getMaterial(this.material).kFriction; }
+	set kineticFriction(v) { this._setMaterialValue('kFriction', v); }
+
+	get linearDamping() { return this.world.getMaterial(this.material).linearDamping; }
+	set linearDamping(v) { this._setMaterialValue('linearDamping', v); }
+
+	get angularDamping() { return this.world.getMaterial(this.material).angularDamping; }
+	set angularDamping(v) { this._setMaterialValue('angularDamping', v); }
+
+	_setMaterialValue(key, value){
+		let material = this.world.getMaterial(this.material);
+		material[key] = value;
+		if(!this.world.setObjectCoefficients(this.id, material)) throw new Error("Material table is full.");
+	}
 
 	
 
@@ -262,10 +540,19 @@ class Gb2d{
 		this.ELLIPSE = 4;
 		this.CAPSULE = 5;
 		this.POLYGON = 6;
+		this.COMPOUND = 7;
 
 		this.RIGID_BODY = 0;
 		this.SENSOR = 1;
 		this.FIXED_OBJECT = 2;
+
+		this.COLLISION_BEGIN = 0;
+		this.COLLISION_PERSIST = 1;
+		this.COLLISION_END = 2;
+		this.TERRAIN_ID = -2147483648;
+
+		this.DEFAULT_MATERIAL = DEFAULT_MATERIAL;
+		this.TERRAIN_MATERIAL = TERRAIN_MATERIAL;
 	}
 
 	// get World(){ return this._world; }
@@ -1,6 +1,9 @@
 
+#include <algorithm>
+#include <array>
 #include <cfloat>
 #include <unordered_map>
+#include <utility>
 #include <functional>
 #include <iostream>
 #include "collision-solver.h"
@@ -13,14 +16,41 @@ using namespace std;
 // static float _totalInverseMass = 0.0f;
 static int _indexA = 0;
 static int _indexB = 0;
+// Child shapes of compound bodies being collided, or -1.
+static int _childA = -1;
+static int _childB = -1;
 static Vec2 _relativeVelocity;
 
-CollisionSolver::CollisionSolver(vector<int>& intData, vector<float>& floatData)
-    : intData(intData), floatData(floatData) 
+CollisionSolver::CollisionSolver(vector<int>& intData, vector<float>& floatData, vector<ShapeCache>& shapes)
+    : intData(intData), floatData(floatData), shapes(shapes)
 {}
 
 void CollisionSolver::clear() {
-    collisions.clear();
+    resetFrameVector(collisions, frameArena);
+    resetFrameVector(_circleCirclePairs, frameArena);
+    resetFrameVector(_aabbAabbPairs, frameArena);
+    resetFrameVector(_circleBoxPairs, frameArena);
+    resetFrameVector(_otherPairs, frameArena);
+    resetFrameVector(_cacheablePairs, frameArena);
+    pairStamp++;
+}
+
+void CollisionSolver::clearManifolds() {
+    manifolds.clear();
+    droppedManifolds.clear();
+    resetFrameVector(endedManifolds, frameArena);
+    satCache.clear();
+    pairResults.clear();
+}
+
+void CollisionSolver::dropTerrainManifolds() {
+    for (auto it = manifolds.begin(); it != manifolds.end(); ) {
+        if (it->second.idB == TERRAIN_ID) {
+            droppedManifolds.insert(*it);
+            it = manifolds.erase(it);
+        }
+        else ++it;
+    }
 }
 
 void _swap() {
@@ -28,74 +58,362 @@ void _swap() {
     _indexA = _indexB;
     _indexB = tempi;
 
+    tempi = _childA;
+    _childA = _childB;
+    _childB = tempi;
+
     _relativeVelocity = _relativeVelocity * -1.0f;
 }
     
-bool CollisionSolver::solve(int indexA, int indexB) {
+// Supported shape pairs.
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::AABB> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveAabbAabb(); }
+};
+template<> struct PairSolver<ObjectShape::CIRCLE, ObjectShape::CIRCLE> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveCircleCircle(); }
+};
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::CIRCLE> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveAabbCircle(); }
+};
+template<> struct PairSolver<ObjectShape::BOX, ObjectShape::BOX> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveBoxBox(); }
+};
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::BOX> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveAabbBox(); }
+};
+template<> struct PairSolver<ObjectShape::CIRCLE, ObjectShape::BOX> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveCircleBox(); }
+};
+
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::POLYGON> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveOutlines(); }
+};
+template<> struct PairSolver<ObjectShape::BOX, ObjectShape::POLYGON> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveOutlines(); }
+};
+template<> struct PairSolver<ObjectShape::POLYGON, ObjectShape::POLYGON> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveOutlines(); }
+};
+template<> struct PairSolver<ObjectShape::CIRCLE, ObjectShape::POLYGON> {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveCirclePolygon(); }
+};
+
+struct ConvexPairSolver {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveConvex(); }
+};
+template<> struct PairSolver<ObjectShape::CIRCLE, ObjectShape::CAPSULE> : ConvexPairSolver {};
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::CAPSULE> : ConvexPairSolver {};
+template<> struct PairSolver<ObjectShape::BOX, ObjectShape::CAPSULE> : ConvexPairSolver {};
+template<> struct PairSolver<ObjectShape::CAPSULE, ObjectShape::CAPSULE> : ConvexPairSolver {};
+template<> struct PairSolver<ObjectShape::CAPSULE, ObjectShape::POLYGON> : ConvexPairSolver {};
+
+struct CompoundPairSolver {
+    static constexpr bool supported = true;
+    static bool solve(CollisionSolver& solver) { return solver._solveCompound(); }
+};
+template<> struct PairSolver<ObjectShape::CIRCLE, ObjectShape::COMPOUND> : CompoundPairSolver {};
+template<> struct PairSolver<ObjectShape::AABB, ObjectShape::COMPOUND> : CompoundPairSolver {};
+template<> struct PairSolver<ObjectShape::BOX, ObjectShape::COMPOUND> : CompoundPairSolver {};
+template<> struct PairSolver<ObjectShape::POLYGON, ObjectShape::COMPOUND> : CompoundPairSolver {};
+template<> struct PairSolver<ObjectShape::COMPOUND, ObjectShape::COMPOUND> : CompoundPairSolver {};
+
+typedef bool (*PairSolveFunction)(CollisionSolver&);
+
+template<ObjectShape A, ObjectShape B>
+static bool _solveSwapped(CollisionSolver& solver) {
+    _swap();
+    return PairSolver<A, B>::solve(solver);
+}
 
-    _indexA = indexA;
-    _indexB = indexB;
+template<int I>
+constexpr PairSolveFunction _pairTableEntry() {
+    constexpr ObjectShape a = static_cast<ObjectShape>(I / OBJECT_SHAPE_COUNT);
+    constexpr ObjectShape b = static_cast<ObjectShape>(I % OBJECT_SHAPE_COUNT);
+    return PairSolver<a, b>::supported ? &PairSolver<a, b>::solve
+        : PairSolver<b, a>::supported ? &_solveSwapped<b, a>
+        : &PairSolver<a, b>::solve;
+}
+
+template<int... I>
+constexpr array<PairSolveFunction, sizeof...(I)> _makePairTable(integer_sequence<int, I...>) {
+    return {{ _pairTableEntry<I>()... }};
+}
+
+// Indexed by shapeA * OBJECT_SHAPE_COUNT + shapeB.
+static constexpr array<PairSolveFunction, OBJECT_SHAPE_COUNT * OBJECT_SHAPE_COUNT> _pairTable =
+    _makePairTable(make_integer_sequence<int, OBJECT_SHAPE_COUNT * OBJECT_SHAPE_COUNT>());
 
-    int shapeA = intData[_indexA * LIVE_INT_EPO + LIVE_INT_SHAPE];
-    int shapeB = intData[_indexB * LIVE_INT_EPO + LIVE_INT_SHAPE];
+bool CollisionSolver::solve(int indexA, int indexB) {
+    unsigned int shapeA = static_cast<unsigned int>(intData[indexA * LIVE_INT_EPO + LIVE_INT_SHAPE]);
+    unsigned int shapeB = static_cast<unsigned int>(intData[indexB * LIVE_INT_EPO + LIVE_INT_SHAPE]);
+    if(shapeA >= OBJECT_SHAPE_COUNT || shapeB >= OBJECT_SHAPE_COUNT) return false;
 
     // _totalInverseMass = floatData[_indexA * FDATA_EPO + FDATA_IM] + floatData[_indexB * FDATA_EPO + FDATA_IM];
 
+    _beginPair(indexA, indexB);
+    return _pairTable[shapeA * OBJECT_SHAPE_COUNT + shapeB](*this);
+}
+
+// Make the pair the one _addCollision reports.
+void CollisionSolver::_beginPair(int indexA, int indexB) {
+    _indexA = indexA;
+    _indexB = indexB;
+    _childA = -1;
+    _childB = -1;
     _relativeVelocity = Vec2(
         floatData[_indexB * FDATA_EPO + FDATA_VX] - floatData[_indexA * FDATA_EPO + FDATA_VX],
         floatData[_indexB * FDATA_EPO + FDATA_VY] - floatData[_indexA * FDATA_EPO + FDATA_VY]
     );
+}
 
-    switch(shapeA){
-        case static_cast<int>(ObjectShape::AABB):
-            switch(shapeB){
-                case static_cast<int>(ObjectShape::AABB):
-                    return _solveAabbAabb();
-                case static_cast<int>(ObjectShape::CIRCLE):
-                    return _solveAabbCircle();
-                case static_cast<int>(ObjectShape::BOX):
-                    return _solveAabbBox();
-                default:
-                    cerr << "Unsupported collision shape combo." << endl;
-                    break;
-            }
-        case static_cast<int>(ObjectShape::CIRCLE):
-            switch(shapeB){
-                case static_cast<int>(ObjectShape::CIRCLE):
-                    return _solveCircleCircle();
-                case static_cast<int>(ObjectShape::AABB):
-                    _swap();
-                    return _solveAabbCircle();
-                case static_cast<int>(ObjectShape::BOX):
-                    return _solveCircleBox();
-                default:
-                    cerr << "Unsupported collision shape combo." << endl;
-                    break;
-            }
-            break;
-        case static_cast<int>(ObjectShape::BOX):
-            switch(shapeB){
-                case static_cast<int>(ObjectShape::AABB):
-                    _swap();
-                    return _solveAabbBox();
-                case static_cast<int>(ObjectShape::CIRCLE):
-                    _swap();
-                    return _solveCircleBox();
-                case static_cast<int>(ObjectShape::BOX):
-                    return _solveBoxBox();
-                default:
-                    cerr << "Unsupported collision shape combo." << endl;
-                    break;
-            }
-            break;
-        default: 
-            cerr << "Unsupported collision shape combo." << endl;
-            break;
+bool CollisionSolver::overlaps(int indexA, int indexB) {
+    size_t count = collisions.size();
+    bool hit = solve(indexA, indexB);
+    collisions.resize(count);
+    return hit;
+}
+
+
+// Pairs per kernel block. Lane data lives on the stack.
+#define NARROW_PHASE_LANES 64
+
+void CollisionSolver::addPair(int indexA, int indexB, bool cacheable) {
+    int shapeA = intData[indexA * LIVE_INT_EPO + LIVE_INT_SHAPE];
+    int shapeB = intData[indexB * LIVE_INT_EPO + LIVE_INT_SHAPE];
+    int compound = static_cast<int>(ObjectShape::COMPOUND);
+
+    // A compound pair can produce several collisions, which the result cache doesn't hold.
+    if(cacheable && shapeA != compound && shapeB != compound){
+        _cacheablePairs.push_back(indexA);
+        _cacheablePairs.push_back(indexB);
     }
 
-    return false;
+    int circle = static_cast<int>(ObjectShape::CIRCLE);
+    int aabb = static_cast<int>(ObjectShape::AABB);
+    int box = static_cast<int>(ObjectShape::BOX);
+
+    FrameVector<int>* bucket = &_otherPairs;
+    if(shapeA == circle && shapeB == circle) bucket = &_circleCirclePairs;
+    else if(shapeA == aabb && shapeB == aabb) bucket = &_aabbAabbPairs;
+    else if(shapeA == circle && shapeB == box) bucket = &_circleBoxPairs;
+    else if(shapeA == box && shapeB == circle){
+        bucket = &_circleBoxPairs;
+        swap(indexA, indexB);
+    }
+
+    bucket->push_back(indexA);
+    bucket->push_back(indexB);
+}
+
+void CollisionSolver::solvePairs() {
+    // Room for one collision per pair. Compounds add one per touching child pair and terrain adds
+    // its own, so the output can still grow while it's filled: hold indices into it, not addresses.
+    collisions.reserve(collisions.size() + (_circleCirclePairs.size() + _aabbAabbPairs.size()
+        + _circleBoxPairs.size() + _otherPairs.size()) / 2);
+
+    size_t firstCollision = collisions.size();
+
+    _solveCircleCirclePairs();
+    _solveAabbAabbPairs();
+    _solveCircleBoxPairs();
+
+    for (size_t i = 0; i < _otherPairs.size(); i += 2) {
+        solve(_otherPairs[i], _otherPairs[i + 1]);
+    }
+
+    _storePairResults(firstCollision);
+}
+
+bool CollisionSolver::reusePair(int indexA, int indexB) {
+    auto it = pairResults.find(makePairKey(
+        intData[indexA * LIVE_INT_EPO + LIVE_INT_ID],
+        intData[indexB * LIVE_INT_EPO + LIVE_INT_ID]
+    ));
+    if (it == pairResults.end()) return false;
+
+    // The objects may have been moved to other indices by a removal since.
+    PairResult& result = it->second;
+    bool sameIndices = (result.indexA == indexA && result.indexB == indexB)
+        || (result.indexA == indexB && result.indexB == indexA);
+    if (!sameIndices) return false;
+
+    result.stamp = pairStamp;
+    if (result.hit) collisions.push_back(result.info);
+    return true;
+}
+
+void CollisionSolver::_storePairResults(size_t firstCollision) {
+    // Every cacheable pair starts as a miss. The collisions of this call then fill in the hits.
+    for (size_t i = 0; i < _cacheablePairs.size(); i += 2) {
+        int indexA = _cacheablePairs[i];
+        int indexB = _cacheablePairs[i + 1];
+        PairResult& result = pairResults[makePairKey(
+            intData[indexA * LIVE_INT_EPO + LIVE_INT_ID],
+            intData[indexB * LIVE_INT_EPO + LIVE_INT_ID]
+        )];
+        result.stamp = pairStamp;
+        result.indexA = indexA;
+        result.indexB = indexB;
+        result.hit = false;
+    }
+
+    if (!_cacheablePairs.empty()) {
+        for (size_t i = firstCollision; i < collisions.size(); i++) {
+            const CollisionInfo& collision = collisions[i];
+            auto it = pairResults.find(makePairKey(
+                intData[collision.indexA * LIVE_INT_EPO + LIVE_INT_ID],
+                intData[collision.indexB * LIVE_INT_EPO + LIVE_INT_ID]
+            ));
+            if (it == pairResults.end() || it->second.stamp != pairStamp) continue;
+
+            it->second.hit = true;
+            it->second.info = collision;
+        }
+    }
+
+    // Drop the results of pairs that were neither reused nor cached this step.
+    for (auto it = pairResults.begin(); it != pairResults.end(); ) {
+        if (it->second.stamp != pairStamp) it = pairResults.erase(it);
+        else ++it;
+    }
+}
+
+void CollisionSolver::_solveCircleCirclePairs() {
+    float ax[NARROW_PHASE_LANES], ay[NARROW_PHASE_LANES], ar[NARROW_PHASE_LANES];
+    float bx[NARROW_PHASE_LANES], by[NARROW_PHASE_LANES], br[NARROW_PHASE_LANES];
+    float dx[NARROW_PHASE_LANES], dy[NARROW_PHASE_LANES], d2[NARROW_PHASE_LANES];
+    int hit[NARROW_PHASE_LANES];
+
+    int pairCount = static_cast<int>(_circleCirclePairs.size() / 2);
+    for (int begin = 0; begin < pairCount; begin += NARROW_PHASE_LANES) {
+        int n = min(NARROW_PHASE_LANES, pairCount - begin);
+        const int* pairs = &_circleCirclePairs[begin * 2];
+
+        for (int i = 0; i < n; i++) {
+            const float* a = &floatData[pairs[i * 2] * FDATA_EPO];
+            const float* b = &floatData[pairs[i * 2 + 1] * FDATA_EPO];
+            ax[i] = a[FDATA_X]; ay[i] = a[FDATA_Y]; ar[i] = a[FDATA_RADIUS];
+            bx[i] = b[FDATA_X]; by[i] = b[FDATA_Y]; br[i] = b[FDATA_RADIUS];
+        }
+
+        // Kernel.
+        for (int i = 0; i < n; i++) {
+            dx[i] = bx[i] - ax[i];
+            dy[i] = by[i] - ay[i];
+            d2[i] = dx[i] * dx[i] + dy[i] * dy[i];
+            float r = ar[i] + br[i];
+            hit[i] = r * r > d2[i];
+        }
+
+        // Compact the hits into contacts (same as _solveCircleCircle).
+        for (int i = 0; i < n; i++) {
+            if(!hit[i]) continue;
+
+            _beginPair(pairs[i * 2], pairs[i * 2 + 1]);
+
+            float distance = sqrt(d2[i]);
+            Vec2 normal = distance > 0.0f ? Vec2(dx[i] / distance, dy[i] / distance) : Vec2();
+            ContactPoint point{Vec2(ax[i], ay[i]) + normal * ar[i], ar[i] + br[i] - distance, 0, 0.0f, 0.0f};
+            _addCollision(normal, &point, 1);
+        }
+    }
 }
 
+void CollisionSolver::_solveAabbAabbPairs() {
+    float ax[NARROW_PHASE_LANES], ay[NARROW_PHASE_LANES], aw[NARROW_PHASE_LANES], ah[NARROW_PHASE_LANES];
+    float bx[NARROW_PHASE_LANES], by[NARROW_PHASE_LANES], bw[NARROW_PHASE_LANES], bh[NARROW_PHASE_LANES];
+    float minX[NARROW_PHASE_LANES], maxX[NARROW_PHASE_LANES], minY[NARROW_PHASE_LANES], maxY[NARROW_PHASE_LANES];
+    int hit[NARROW_PHASE_LANES];
+
+    int pairCount = static_cast<int>(_aabbAabbPairs.size() / 2);
+    for (int begin = 0; begin < pairCount; begin += NARROW_PHASE_LANES) {
+        int n = min(NARROW_PHASE_LANES, pairCount - begin);
+        const int* pairs = &_aabbAabbPairs[begin * 2];
+
+        for (int i = 0; i < n; i++) {
+            const float* a = &floatData[pairs[i * 2] * FDATA_EPO];
+            const float* b = &floatData[pairs[i * 2 + 1] * FDATA_EPO];
+            ax[i] = a[FDATA_X]; ay[i] = a[FDATA_Y]; aw[i] = a[FDATA_W]; ah[i] = a[FDATA_H];
+            bx[i] = b[FDATA_X]; by[i] = b[FDATA_Y]; bw[i] = b[FDATA_W]; bh[i] = b[FDATA_H];
+        }
+
+        // Kernel. Same overlap test as _solveAabbAabb, and the overlapping span on each axis.
+        for (int i = 0; i < n; i++) {
+            bool separatedX = (ax[i] + aw[i] / 2 < bx[i] - bw[i] / 2) | (bx[i] + bw[i] / 2 < ax[i] - aw[i] / 2);
+            bool separatedY = (ay[i] + ah[i] / 2 < by[i] - bh[i] / 2) | (by[i] + bh[i] / 2 < ay[i] - ah[i] / 2);
+            hit[i] = !(separatedX | separatedY);
+            minX[i] = max(ax[i] - aw[i] / 2, bx[i] - bw[i] / 2);
+            maxX[i] = min(ax[i] + aw[i] / 2, bx[i] + bw[i] / 2);
+            minY[i] = max(ay[i] - ah[i] / 2, by[i] - bh[i] / 2);
+            maxY[i] = min(ay[i] + ah[i] / 2, by[i] + bh[i] / 2);
+        }
+
+        for (int i = 0; i < n; i++) {
+            if(!hit[i]) continue;
+
+            _beginPair(pairs[i * 2], pairs[i * 2 + 1]);
+            _addAabbContact(Vec2(ax[i], ay[i]), Vec2(bx[i], by[i]), minX[i], maxX[i], minY[i], maxY[i]);
+        }
+    }
+}
+
+void CollisionSolver::_solveCircleBoxPairs() {
+    float dx[NARROW_PHASE_LANES], dy[NARROW_PHASE_LANES], radius[NARROW_PHASE_LANES];
+    float cosine[NARROW_PHASE_LANES], sine[NARROW_PHASE_LANES];
+    float halfW[NARROW_PHASE_LANES], halfH[NARROW_PHASE_LANES];
+    float closestX[NARROW_PHASE_LANES], closestY[NARROW_PHASE_LANES];
+    float offsetX[NARROW_PHASE_LANES], offsetY[NARROW_PHASE_LANES];
+    int hit[NARROW_PHASE_LANES];
+
+    int pairCount = static_cast<int>(_circleBoxPairs.size() / 2);
+    for (int begin = 0; begin < pairCount; begin += NARROW_PHASE_LANES) {
+        int n = min(NARROW_PHASE_LANES, pairCount - begin);
+        const int* pairs = &_circleBoxPairs[begin * 2];
+
+        for (int i = 0; i < n; i++) {
+            const float* circle = &floatData[pairs[i * 2] * FDATA_EPO];
+            const float* box = &floatData[pairs[i * 2 + 1] * FDATA_EPO];
+            dx[i] = circle[FDATA_X] - box[FDATA_X];
+            dy[i] = circle[FDATA_Y] - box[FDATA_Y];
+            radius[i] = circle[FDATA_RADIUS];
+            cosine[i] = shapes[pairs[i * 2 + 1]].axisX.x;
+            sine[i] = shapes[pairs[i * 2 + 1]].axisX.y;
+            halfW[i] = box[FDATA_W] / 2.0f;
+            halfH[i] = box[FDATA_H] / 2.0f;
+        }
+
+        // Kernel. Closest point on the box to the circle center, in the box's local space.
+        for (int i = 0; i < n; i++) {
+            float localX = dx[i] * cosine[i] + dy[i] * sine[i];
+            float localY = dy[i] * cosine[i] - dx[i] * sine[i];
+            closestX[i] = max(-halfW[i], min(localX, halfW[i]));
+            closestY[i] = max(-halfH[i], min(localY, halfH[i]));
+            offsetX[i] = closestX[i] - localX;
+            offsetY[i] = closestY[i] - localY;
+            hit[i] = offsetX[i] * offsetX[i] + offsetY[i] * offsetY[i] < radius[i] * radius[i];
+        }
+
+        for (int i = 0; i < n; i++) {
+            if(!hit[i]) continue;
+
+            int box = pairs[i * 2 + 1];
+            _beginPair(pairs[i * 2], box);
+            _addCircleBoxContact(radius[i], Vec2(floatData[box * FDATA_EPO + FDATA_X], floatData[box * FDATA_EPO + FDATA_Y]),
+                shapes[box].axisX, shapes[box].axisY, Vec2(closestX[i], closestY[i]), Vec2(offsetX[i], offsetY[i]));
+        }
+    }
+}
 
 bool CollisionSolver::_solveAabbAabb() {
     // Get AABB A data
@@ -133,46 +451,42 @@ bool CollisionSolver::_solveAabbAabb() {
     }
 
     // We have overlap in both X and Y, so a collision is happening
+    _addAabbContact(Vec2(xA, yA), Vec2(xB, yB), max(minXA, minXB), min(maxXA, maxXB), max(minYA, minYB), min(maxYA, maxYB));
 
-    // Calculate the overlap depth on the X axis
-    float overlapX = min(maxXA, maxXB) - max(minXA, minXB);
-
-    // Calculate the overlap depth on the Y axis
-    float overlapY = min(maxYA, maxYB) - max(minYA, minYB);
+    return true;
+}
 
-    // Determine the collision normal based on the smallest overlap
+// Contact of two overlapping AABBs from the overlapping span on each axis.
+void CollisionSolver::_addAabbContact(const Vec2& centerA, const Vec2& centerB, float overlapMinX, float overlapMaxX,
+                                      float overlapMinY, float overlapMaxY) {
+    float xA = centerA.x, yA = centerA.y;
+    float xB = centerB.x, yB = centerB.y;
+    float overlapX = overlapMaxX - overlapMinX;
+    float overlapY = overlapMaxY - overlapMinY;
+
+    // Determine the collision normal based on the smallest overlap.
+    // The two contact points are the ends of the overlapping span on the other axis,
+    // placed in the middle of the penetration.
     Vec2 normal;
-    float penetrationDepth;
-    
+    ContactPoint points[2];
+
     if (overlapX < overlapY) {
         // Collision is primarily on the X axis
-        penetrationDepth = overlapX;
-        Vec2 normalDirection = Vec2(xB - xA, 0.0f);
-        normal = (normalDirection.dot(Vec2(1.0f, 0.0f)) > 0.0f) ? Vec2(1.0f, 0.0f) : Vec2(-1.0f, 0.0f);
+        int side = (xB - xA > 0.0f) ? 0 : 1;
+        normal = side == 0 ? Vec2(1.0f, 0.0f) : Vec2(-1.0f, 0.0f);
+        float contactX = (overlapMinX + overlapMaxX) / 2;
+        points[0] = ContactPoint{Vec2(contactX, overlapMinY), overlapX, side * 4 + 0, 0.0f, 0.0f};
+        points[1] = ContactPoint{Vec2(contactX, overlapMaxY), overlapX, side * 4 + 1, 0.0f, 0.0f};
     } else {
         // Collision is primarily on the Y axis
-        penetrationDepth = overlapY;
-        Vec2 normalDirection = Vec2(0.0f, yB - yA);
-        normal = (normalDirection.dot(Vec2(0.0f, 1.0f)) > 0.0f) ? Vec2(0.0f, 1.0f) : Vec2(0.0f, -1.0f);
+        int side = (yB - yA > 0.0f) ? 2 : 3;
+        normal = side == 2 ? Vec2(0.0f, 1.0f) : Vec2(0.0f, -1.0f);
+        float contactY = (overlapMinY + overlapMaxY) / 2;
+        points[0] = ContactPoint{Vec2(overlapMinX, contactY), overlapY, side * 4 + 0, 0.0f, 0.0f};
+        points[1] = ContactPoint{Vec2(overlapMaxX, contactY), overlapY, side * 4 + 1, 0.0f, 0.0f};
     }
 
-    // Calculate the contact point (optional, approximate it to the center of overlap)
-    float contactX = (max(minXA, minXB) + min(maxXA, maxXB)) / 2;
-    float contactY = (max(minYA, minYB) + min(maxYA, maxYB)) / 2;
-
-    // Store the collision info
-    collisions.push_back(CollisionInfo{
-        true,                        // Collision detected
-        Vec2(contactX, contactY),     // Contact point
-        normal,                      // Collision normal
-        penetrationDepth,            // Penetration depth
-        _indexA,                     // Object A index
-        _indexB,                     // Object B index
-        _relativeVelocity,           // Relative velocity (already computed)
-        0.0f                         // Friction placeholder (can be computed later)
-    });
-
-    return true;
+    _addCollision(normal, points, 2);
 }
 
 
@@ -196,14 +510,8 @@ bool CollisionSolver::_solveCircleCircle() {
         auto normal = pDiff.normalize();
         auto penetrationDepth = rA + rB - pDiff.magnitude();
         auto contactPoint = pA + normal * rA;
-        collisions.push_back(CollisionInfo{
-            true, 
-            contactPoint, 
-            normal, 
-            penetrationDepth, 
-            _indexA, _indexB,
-            _relativeVelocity, 0.0f
-        });
+        ContactPoint point{contactPoint, penetrationDepth, 0, 0.0f, 0.0f};
+        _addCollision(normal, &point, 1);
         return true;
     }
 
@@ -250,14 +558,8 @@ bool CollisionSolver::_solveAabbCircle() {
             normal = distanceVec / -distance;
         }
 
-        collisions.push_back(CollisionInfo{
-            true, 
-            Vec2(closestX, closestY), 
-            normal, 
-            penetrationDepth, 
-            _indexA, _indexB,
-            _relativeVelocity, 0.0f
-        });
+        ContactPoint point{Vec2(closestX, closestY), penetrationDepth, 0, 0.0f, 0.0f};
+        _addCollision(normal, &point, 1);
 
         return true;
     }
@@ -266,310 +568,826 @@ bool CollisionSolver::_solveAabbCircle() {
 }
 
 bool CollisionSolver::_solveBoxBox() {
-    // Get Box A data
+    const ShapeCache& a = shapes[_indexA];
+    const ShapeCache& b = shapes[_indexB];
+
+    return _collidePolygons(a.vertices, a.normals, a.vertexCount, 0.0f, b.vertices, b.normals, b.vertexCount, 0.0f);
+}
+
+
+bool CollisionSolver::_solveAabbBox() {
+    // The cached outline of an AABB is a box whose rotation is always zero.
+    const ShapeCache& a = shapes[_indexA];
+    const ShapeCache& b = shapes[_indexB];
+
+    return _collidePolygons(a.vertices, a.normals, a.vertexCount, 0.0f, b.vertices, b.normals, b.vertexCount, 0.0f);
+}
+
+bool CollisionSolver::_solveCircleBox() {
+    // Get Circle (Object A) data
+    float rA = floatData[_indexA * FDATA_EPO + FDATA_RADIUS];
     float xA = floatData[_indexA * FDATA_EPO + FDATA_X];
     float yA = floatData[_indexA * FDATA_EPO + FDATA_Y];
-    float wA = floatData[_indexA * FDATA_EPO + FDATA_W];
-    float hA = floatData[_indexA * FDATA_EPO + FDATA_H];
-    float rotationA = floatData[_indexA * FDATA_EPO + FDATA_R];
 
-    // Get Box B data
+    // Get Box (Object B) data
     float xB = floatData[_indexB * FDATA_EPO + FDATA_X];
     float yB = floatData[_indexB * FDATA_EPO + FDATA_Y];
     float wB = floatData[_indexB * FDATA_EPO + FDATA_W];
     float hB = floatData[_indexB * FDATA_EPO + FDATA_H];
-    float rotationB = floatData[_indexB * FDATA_EPO + FDATA_R];
-
-    // Compute rotation matrices for both boxes
-    Vec2 axisA1(cos(rotationA), sin(rotationA));   // X-axis for Box A
-    Vec2 axisA2(-sin(rotationA), cos(rotationA));  // Y-axis for Box A
-    Vec2 axisB1(cos(rotationB), sin(rotationB));   // X-axis for Box B
-    Vec2 axisB2(-sin(rotationB), cos(rotationB));  // Y-axis for Box B
-
-    // The potential separating axes are the normals of both box edges
-    Vec2 axes[] = {axisA1, axisA2, axisB1, axisB2};
-
-    float minPenetrationDepth = FLT_MAX;  // Store minimum penetration depth
-    Vec2 bestAxis;  // Store the axis that results in the smallest penetration
-
-    // Helper function to project a box onto an axis
-    auto projectBoxOntoAxis = [&](float x, float y, float w, float h, float rotation, const Vec2& axis) {
-        Vec2 corners[4];
-        float hw = w / 2.0f;
-        float hh = h / 2.0f;
-
-        // Get the rotated corners of the box
-        corners[0] = Vec2(-hw, -hh).rotate(rotation) + Vec2(x, y);
-        corners[1] = Vec2(hw, -hh).rotate(rotation) + Vec2(x, y);
-        corners[2] = Vec2(hw, hh).rotate(rotation) + Vec2(x, y);
-        corners[3] = Vec2(-hw, hh).rotate(rotation) + Vec2(x, y);
-
-        // Project all corners onto the axis and find the min/max projections
-        float minProj = corners[0].dot(axis);
-        float maxProj = minProj;
-
-        for (int i = 1; i < 4; i++) {
-            float proj = corners[i].dot(axis);
-            if (proj < minProj) minProj = proj;
-            if (proj > maxProj) maxProj = proj;
-        }
+    const Vec2& axisX = shapes[_indexB].axisX;
+    const Vec2& axisY = shapes[_indexB].axisY;
 
-        return std::make_pair(minProj, maxProj);
-    };
+    // Compute the relative position of the circle's center to the box's center
+    Vec2 circleCenter(xA, yA);
+    Vec2 boxCenter(xB, yB);
+    Vec2 relCircleCenter = circleCenter - boxCenter;
 
-    // Check all axes for overlap
-    for (const Vec2& axis : axes) {
-        // Project both boxes onto the current axis
-        auto [minA, maxA] = projectBoxOntoAxis(xA, yA, wA, hA, rotationA, axis);
-        auto [minB, maxB] = projectBoxOntoAxis(xB, yB, wB, hB, rotationB, axis);
+    // Rotate the relative position into the box's local space (unrotate the box)
+    Vec2 localCircleCenter(relCircleCenter.dot(axisX), relCircleCenter.dot(axisY));
 
-        // Check for overlap between projections
-        if (maxA < minB || maxB < minA) {
-            // No overlap on this axis, so there is a separating axis -> no collision
-            return false;
-        }
+    // Box half-extents
+    float halfW = wB / 2.0f;
+    float halfH = hB / 2.0f;
+
+    // Find the closest point on the box to the circle in the box's local space
+    float closestX = max(-halfW, min(localCircleCenter.x, halfW));
+    float closestY = max(-halfH, min(localCircleCenter.y, halfH));
+
+    // Compute the distance vector between the circle's center and the closest point
+    Vec2 closestPointLocal(closestX, closestY);
+    Vec2 distanceVecLocal = closestPointLocal - localCircleCenter;
+
+    // Calculate the squared distance
+    float distanceSquared = distanceVecLocal.magnitudeSquared();
+
+    // Check if the distance squared is less than the circle's radius squared
+    if (distanceSquared < rA * rA) {
+        _addCircleBoxContact(rA, boxCenter, axisX, axisY, closestPointLocal, distanceVecLocal);
+        return true;
+    }
+
+    return false;  // No collision
+}
+
+// Contact of a circle (A) touching a box (B), from the closest point on the box to the circle's
+// center and the offset to it from the center, both in the box's local space.
+void CollisionSolver::_addCircleBoxContact(float radius, const Vec2& boxCenter, const Vec2& axisX, const Vec2& axisY,
+                                           const Vec2& closestPointLocal, const Vec2& distanceVecLocal) {
+    // Compute the penetration depth
+    float distance = sqrt(distanceVecLocal.magnitudeSquared());
+    float penetrationDepth = radius - distance;
+
+    // Compute the collision normal in local space
+    Vec2 normalLocal = (distance == 0) ? Vec2(1.0f, 0.0f) : distanceVecLocal / distance;
+
+    // Rotate the normal back to world space
+    Vec2 normal = axisX * normalLocal.x + axisY * normalLocal.y;
+
+    // Find the closest point in world space
+    Vec2 closestPointWorld = axisX * closestPointLocal.x + axisY * closestPointLocal.y + boxCenter;
+
+    // Store the collision info
+    ContactPoint point{closestPointWorld, penetrationDepth, 0, 0.0f, 0.0f};
+    _addCollision(normal, &point, 1);
+}
 
-        // Calculate the penetration depth on this axis
-        float overlap = std::min(maxA, maxB) - std::max(minA, minB);
-        if (overlap < minPenetrationDepth) {
-            minPenetrationDepth = overlap;
-            bestAxis = axis;
+bool CollisionSolver::_solveOutlines() {
+    const ShapeCache& a = shapes[_indexA];
+    const ShapeCache& b = shapes[_indexB];
+
+    // A polygon without a record has no outline.
+    if (a.vertexCount == 0 || b.vertexCount == 0) return false;
+
+    return _collidePolygons(a.vertices, a.normals, a.vertexCount, 0.0f, b.vertices, b.normals, b.vertexCount, 0.0f);
+}
+
+bool CollisionSolver::_solveCirclePolygon() {
+    const ShapeCache& polygon = shapes[_indexB];
+    if (polygon.vertexCount == 0) return false;
+
+    float radius = floatData[_indexA * FDATA_EPO + FDATA_RADIUS];
+    Vec2 center(floatData[_indexA * FDATA_EPO + FDATA_X], floatData[_indexA * FDATA_EPO + FDATA_Y]);
+
+    return _collideCirclePolygon(center, radius, polygon.vertices, polygon.normals, polygon.vertexCount, false);
+}
+
+bool CollisionSolver::_collideCirclePolygon(const Vec2& center, float radius, const Vec2* vertices, const Vec2* normals, int count,
+                                            bool circleIsB) {
+    // Edge with the largest separation from the center.
+    int edge = 0;
+    float separation = -FLT_MAX;
+    for (int i = 0; i < count; i++) {
+        float s = normals[i].dot(center - vertices[i]);
+        if (s > separation) {
+            separation = s;
+            edge = i;
         }
     }
+    if (separation > radius) return false;
 
-    // If we get here, the boxes are colliding on all axes
-    // Compute the vector from Box A to Box B
-    Vec2 AB = Vec2(xB - xA, yB - yA);
+    const Vec2& v1 = vertices[edge];
+    const Vec2& v2 = vertices[edge + 1 < count ? edge + 1 : 0];
 
-    // Adjust the normal direction based on the relative position of the boxes
+    // The normal points from the circle to the polygon. Past either end of the edge, the closest
+    // feature is that vertex.
+    ContactPoint point{Vec2(), 0.0f, edge, 0.0f, 0.0f};
     Vec2 normal;
-    if (AB.dot(bestAxis) > 0.0f) {
-        normal = bestAxis;
-    } else {
-        normal = -bestAxis;
+    const Vec2* vertex = nullptr;
+    if ((center - v1).dot(v2 - v1) <= 0.0f) {
+        vertex = &v1;
+        point.featureId = 0x100 | edge;
+    }
+    else if ((center - v2).dot(v1 - v2) <= 0.0f) {
+        vertex = &v2;
+        point.featureId = 0x100 | (edge + 1 < count ? edge + 1 : 0);
     }
 
-    // Compute the contact point (optional, approximate it)
-    // TODO: this approximation is not accurate.
-    // I recommend doing a rework. This will require computig multiple collision points.
-    Vec2 contactPoint = Vec2((xA + xB) / 2, (yA + yB) / 2);  // Midpoint approximation
- 
-    // Store the collision info
-    collisions.push_back(CollisionInfo{
-        true,                      // Collision detected
-        contactPoint,               // Contact point
-        normal,                    // Collision normal
-        minPenetrationDepth,        // Penetration depth
-        _indexA,                   // Object A index
-        _indexB,                   // Object B index
-        _relativeVelocity,         // Relative velocity (already computed)
-        0.0f                       // Friction placeholder (can be computed later)
-    });
+    if (vertex) {
+        Vec2 d = *vertex - center;
+        float distanceSquared = d.magnitudeSquared();
+        if (distanceSquared > radius * radius) return false;
+
+        float distance = sqrt(distanceSquared);
+        normal = distance > 0.0f ? d / distance : -normals[edge];
+        point.point = *vertex;
+        point.penetrationDepth = radius - distance;
+    }
+    else {
+        normal = -normals[edge];
+        point.point = center - normals[edge] * separation;
+        point.penetrationDepth = radius - separation;
+    }
 
+    _addCollision(circleIsB ? -normal : normal, &point, 1);
     return true;
 }
 
+bool CollisionSolver::_collideConvex(const ConvexGeometry& a, const ConvexGeometry& b) {
+    // Circles and capsules are rounded segments (a circle's segment has no length).
+    if (a.vertexCount <= 2 && b.vertexCount <= 2) {
+        return _collideSegments(a.vertices[0], a.vertices[a.vertexCount - 1], a.radius,
+                                b.vertices[0], b.vertices[b.vertexCount - 1], b.radius);
+    }
 
-bool CollisionSolver::_solveAabbBox() {
-    // Get AABB (Object A) data
-    float xA = floatData[_indexA * FDATA_EPO + FDATA_X];
-    float yA = floatData[_indexA * FDATA_EPO + FDATA_Y];
-    float wA = floatData[_indexA * FDATA_EPO + FDATA_W];
-    float hA = floatData[_indexA * FDATA_EPO + FDATA_H];
+    if (a.vertexCount == 1) return _collideCirclePolygon(a.vertices[0], a.radius, b.vertices, b.normals, b.vertexCount, false);
+    if (b.vertexCount == 1) return _collideCirclePolygon(b.vertices[0], b.radius, a.vertices, a.normals, a.vertexCount, true);
+    if (a.vertexCount == 2) return _collideCapsulePolygon(a, b, false);
+    if (b.vertexCount == 2) return _collideCapsulePolygon(b, a, true);
 
-    // Get Box (Object B) data
-    float xB = floatData[_indexB * FDATA_EPO + FDATA_X];
-    float yB = floatData[_indexB * FDATA_EPO + FDATA_Y];
-    float wB = floatData[_indexB * FDATA_EPO + FDATA_W];
-    float hB = floatData[_indexB * FDATA_EPO + FDATA_H];
-    float rotationB = floatData[_indexB * FDATA_EPO + FDATA_R];
-
-    // AABB's axes are just the X and Y world axes
-    Vec2 axisA1(1.0f, 0.0f);  // X-axis
-    Vec2 axisA2(0.0f, 1.0f);  // Y-axis
-
-    // Box B's rotated axes
-    Vec2 axisB1(cos(rotationB), sin(rotationB));    // X-axis for Box B
-    Vec2 axisB2(-sin(rotationB), cos(rotationB));   // Y-axis for Box B
-
-    // The separating axes to test: X and Y for AABB, rotated axes for Box B
-    Vec2 axes[] = {axisA1, axisA2, axisB1, axisB2};
-
-    float minPenetrationDepth = FLT_MAX;  // Store the minimum penetration depth
-    Vec2 bestAxis;  // Store the axis that results in the smallest penetration
-    bool isColliding = true;
-
-    // Helper function to project the AABB onto an axis
-    auto projectAabbOntoAxis = [&](float x, float y, float w, float h, const Vec2& axis) {
-        // Get the min/max of the AABB based on its extents
-        float hw = w / 2.0f;
-        float hh = h / 2.0f;
-
-        // Project the corners of the AABB onto the axis
-        Vec2 corners[4] = {
-            Vec2(x - hw, y - hh),
-            Vec2(x + hw, y - hh),
-            Vec2(x + hw, y + hh),
-            Vec2(x - hw, y + hh)
-        };
-
-        // Find the minimum and maximum projection values
-        float minProj = corners[0].dot(axis);
-        float maxProj = minProj;
-
-        for (int i = 1; i < 4; i++) {
-            float proj = corners[i].dot(axis);
-            if (proj < minProj) minProj = proj;
-            if (proj > maxProj) maxProj = proj;
+    return _collidePolygons(a.vertices, a.normals, a.vertexCount, a.radius, b.vertices, b.normals, b.vertexCount, b.radius);
+}
+
+bool CollisionSolver::_solveConvex() {
+    ConvexGeometry a;
+    ConvexGeometry b;
+    if (!_bodyGeometry(_indexA, a) || !_bodyGeometry(_indexB, b)) return false;
+
+    return _collideConvex(a, b);
+}
+
+// Parameters of the closest points of segments p1-q1 and p2-q2 (Ericson, Real-Time Collision
+// Detection 5.1.9). Degenerate segments are points.
+static void _closestSegmentParameters(const Vec2& p1, const Vec2& q1, const Vec2& p2, const Vec2& q2, float& s, float& t) {
+    Vec2 d1 = q1 - p1;
+    Vec2 d2 = q2 - p2;
+    Vec2 r = p1 - p2;
+    float a = d1.dot(d1);
+    float e = d2.dot(d2);
+    float f = d2.dot(r);
+
+    if (a <= FLT_EPSILON && e <= FLT_EPSILON) {
+        s = t = 0.0f;
+        return;
+    }
+    if (a <= FLT_EPSILON) {
+        s = 0.0f;
+        t = clamp(f / e, 0.0f, 1.0f);
+        return;
+    }
+
+    float c = d1.dot(r);
+    if (e <= FLT_EPSILON) {
+        t = 0.0f;
+        s = clamp(-c / a, 0.0f, 1.0f);
+        return;
+    }
+
+    float b = d1.dot(d2);
+    float denominator = a * e - b * b;
+    s = denominator > 0.0f ? clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+    t = (b * s + f) / e;
+    if (t < 0.0f) {
+        t = 0.0f;
+        s = clamp(-c / a, 0.0f, 1.0f);
+    }
+    else if (t > 1.0f) {
+        t = 1.0f;
+        s = clamp((b - c) / a, 0.0f, 1.0f);
+    }
+}
+
+bool CollisionSolver::_collideSegments(const Vec2& p1, const Vec2& q1, float radius1, const Vec2& p2, const Vec2& q2, float radius2) {
+    float s, t;
+    _closestSegmentParameters(p1, q1, p2, q2, s, t);
+
+    Vec2 c1 = p1 + (q1 - p1) * s;
+    Vec2 c2 = p2 + (q2 - p2) * t;
+    Vec2 d = c2 - c1;
+    float totalRadius = radius1 + radius2;
+    float distanceSquared = d.magnitudeSquared();
+    if (distanceSquared >= totalRadius * totalRadius) return false;
+
+    float distance = sqrt(distanceSquared);
+    Vec2 axis1 = (q1 - p1).normalize();
+    Vec2 axis2 = (q2 - p2).normalize();
+
+    // Cores that cross have no separating direction from their closest points. Use segment 1's
+    // side facing segment 2.
+    Vec2 normal;
+    if (distance > FLT_EPSILON) normal = d / distance;
+    else {
+        normal = Vec2(-axis1.y, axis1.x);
+        if (normal.magnitudeSquared() == 0.0f) normal = Vec2(1.0f, 0.0f);
+        if (normal.dot((p2 + q2) * 0.5f - (p1 + q1) * 0.5f) < 0.0f) normal = -normal;
+    }
+
+    // Side by side capsules get a point at each end of their overlap, so they can rest on each other.
+    float length1 = (q1 - p1).magnitude();
+    bool parallel = length1 > 0.0f && axis2.magnitudeSquared() > 0.0f && fabs(axis1.cross(axis2)) < 0.05f;
+    if (parallel) {
+        float u0 = (p2 - p1).dot(axis1);
+        float u1 = (q2 - p1).dot(axis1);
+        float lower = max(0.0f, min(u0, u1));
+        float upper = min(length1, max(u0, u1));
+
+        if (upper - lower > 0.01f * length1) {
+            Vec2 side = Vec2(-axis1.y, axis1.x);
+            if (side.dot(normal) < 0.0f) side = -side;
+
+            ContactPoint points[MAX_MANIFOLD_POINTS];
+            int pointCount = 0;
+            float bounds[2] = {lower, upper};
+            for (int i = 0; i < 2; i++) {
+                Vec2 onFirst = p1 + axis1 * bounds[i];
+                Vec2 d2 = q2 - p2;
+                Vec2 onSecond = p2 + d2 * clamp((onFirst - p2).dot(d2) / d2.dot(d2), 0.0f, 1.0f);
+                float separation = (onSecond - onFirst).dot(side);
+                if (separation >= totalRadius) continue;
+
+                ContactPoint& point = points[pointCount++];
+                point.point = onFirst + side * ((radius1 + separation - radius2) * 0.5f);
+                point.penetrationDepth = totalRadius - separation;
+                point.featureId = i;
+                point.normalImpulse = 0.0f;
+                point.tangentImpulse = 0.0f;
+            }
+
+            if (pointCount > 0) {
+                _addCollision(side, points, pointCount);
+                return true;
+            }
+        }
+    }
+
+    // Halfway between the two surfaces.
+    ContactPoint point{(c1 + normal * radius1 + c2 - normal * radius2) * 0.5f, totalRadius - distance, 2, 0.0f, 0.0f};
+    _addCollision(normal, &point, 1);
+    return true;
+}
+
+// Closest points of segment p-q and a polygon's outline, and the edge and the parameter along it
+// of the polygon's one. Returns false if the segment touches or crosses the outline, or is inside.
+static bool _closestSegmentPolygon(const Vec2& p, const Vec2& q, const ConvexGeometry& polygon,
+                                   Vec2& onSegment, Vec2& onPolygon, int& edge, float& t) {
+    int count = polygon.vertexCount;
+    bool inside = true;
+    float minDistanceSquared = FLT_MAX;
+    for (int i = 0; i < count; i++) {
+        const Vec2& v1 = polygon.vertices[i];
+        const Vec2& v2 = polygon.vertices[i + 1 < count ? i + 1 : 0];
+        if (polygon.normals[i].dot(p - v1) > 0.0f) inside = false;
+
+        float s, u;
+        _closestSegmentParameters(p, q, v1, v2, s, u);
+        Vec2 c1 = p + (q - p) * s;
+        Vec2 c2 = v1 + (v2 - v1) * u;
+        float distanceSquared = (c2 - c1).magnitudeSquared();
+        if (distanceSquared < minDistanceSquared) {
+            minDistanceSquared = distanceSquared;
+            onSegment = c1;
+            onPolygon = c2;
+            edge = i;
+            t = u;
         }
+    }
 
-        return std::make_pair(minProj, maxProj);
-    };
+    return !inside && minDistanceSquared > FLT_EPSILON;
+}
+
+// A capsule (rounded segment) against an outline. Face-only SAT would push the capsule's end cap
+// out along the face normal even when it's only near a corner, so the closest features decide
+// first. Only when the outline's closest feature is a face (or the cores overlap) does SAT clip
+// against the reference face. A corner gets one point along the line between the closest points.
+bool CollisionSolver::_collideCapsulePolygon(const ConvexGeometry& capsule, const ConvexGeometry& polygon, bool capsuleIsB) {
+    const Vec2& p = capsule.vertices[0];
+    const Vec2& q = capsule.vertices[1];
+    float totalRadius = capsule.radius + polygon.radius;
+
+    Vec2 onSegment;
+    Vec2 onPolygon;
+    int edge;
+    float t;
+    bool separated = _closestSegmentPolygon(p, q, polygon, onSegment, onPolygon, edge, t);
+    if (separated) {
+        Vec2 d = onSegment - onPolygon;
+        float distance = d.magnitude();
+        if (distance >= totalRadius) return false;
+
+        // The closest point is a corner unless the direction to the capsule is (nearly) one of
+        // its faces' normals.
+        int count = polygon.vertexCount;
+        int vertex = -1;
+        if (t <= 0.0f) vertex = edge;
+        else if (t >= 1.0f) vertex = edge + 1 < count ? edge + 1 : 0;
+
+        Vec2 direction = d / distance;
+        if (vertex >= 0) {
+            const Vec2& before = polygon.normals[vertex > 0 ? vertex - 1 : count - 1];
+            const Vec2& after = polygon.normals[vertex];
+            if (direction.dot(before) > 0.999f || direction.dot(after) > 0.999f) vertex = -1;
+        }
 
-    // Helper function to project the rotated box onto an axis (reusing from box-box)
-    auto projectBoxOntoAxis = [&](float x, float y, float w, float h, float rotation, const Vec2& axis) {
-        Vec2 corners[4];
-        float hw = w / 2.0f;
-        float hh = h / 2.0f;
-
-        // Get the rotated corners of the box
-        corners[0] = Vec2(-hw, -hh).rotate(rotation) + Vec2(x, y);
-        corners[1] = Vec2(hw, -hh).rotate(rotation) + Vec2(x, y);
-        corners[2] = Vec2(hw, hh).rotate(rotation) + Vec2(x, y);
-        corners[3] = Vec2(-hw, hh).rotate(rotation) + Vec2(x, y);
-
-        // Project all corners onto the axis and find the min/max projections
-        float minProj = corners[0].dot(axis);
-        float maxProj = minProj;
-
-        for (int i = 1; i < 4; i++) {
-            float proj = corners[i].dot(axis);
-            if (proj < minProj) minProj = proj;
-            if (proj > maxProj) maxProj = proj;
+        if (vertex >= 0) {
+            // The normal points from the capsule to the polygon, then from A to B.
+            Vec2 normal = -direction;
+            ContactPoint point{(onSegment + normal * capsule.radius + onPolygon - normal * polygon.radius) * 0.5f,
+                               totalRadius - distance, 0x200 | vertex, 0.0f, 0.0f};
+            _addCollision(capsuleIsB ? direction : normal, &point, 1);
+            return true;
         }
+    }
+
+    if (capsuleIsB) {
+        return _collidePolygons(polygon.vertices, polygon.normals, polygon.vertexCount, polygon.radius,
+                                capsule.vertices, capsule.normals, capsule.vertexCount, capsule.radius);
+    }
+    return _collidePolygons(capsule.vertices, capsule.normals, capsule.vertexCount, capsule.radius,
+                            polygon.vertices, polygon.normals, polygon.vertexCount, polygon.radius);
+}
+
+bool CollisionSolver::_bodyGeometry(int index, ConvexGeometry& geometry) {
+    const ShapeCache& cache = shapes[index];
+    int shape = intData[index * LIVE_INT_EPO + LIVE_INT_SHAPE];
+
+    if (shape == static_cast<int>(ObjectShape::CIRCLE)) {
+        float radius = floatData[index * FDATA_EPO + FDATA_RADIUS];
+        Vec2 center(floatData[index * FDATA_EPO + FDATA_X], floatData[index * FDATA_EPO + FDATA_Y]);
+        geometry.vertexCount = 1;
+        geometry.radius = radius;
+        geometry.vertices[0] = center;
+        geometry.bounds = Aabb(center - Vec2(radius, radius), center + Vec2(radius, radius));
+        return true;
+    }
+
+    if (cache.vertexCount == 0) return false;
+
+    geometry.vertexCount = cache.vertexCount;
+    geometry.radius = shape == static_cast<int>(ObjectShape::CAPSULE) ? floatData[index * FDATA_EPO + FDATA_H] / 2.0f : 0.0f;
+    geometry.bounds = Aabb();
+    for (int i = 0; i < cache.vertexCount; i++) {
+        geometry.vertices[i] = cache.vertices[i];
+        geometry.normals[i] = cache.normals[i];
+        geometry.bounds.expandToInclude(cache.vertices[i]);
+    }
+    geometry.bounds.expandBy(geometry.radius);
+    return true;
+}
+
+bool CollisionSolver::_solveCompound() {
+    // Compound sorts last, so B is always a compound. A may be one too.
+    const Compound* compoundB = shapes[_indexB].compound;
+    if (!compoundB) return false;
+
+    Vec2 positionB(floatData[_indexB * FDATA_EPO + FDATA_X], floatData[_indexB * FDATA_EPO + FDATA_Y]);
+    const Vec2& axisB = shapes[_indexB].axisX;
+    const Compound* compoundA = shapes[_indexA].compound;
+
+    // Each touching child pair adds its own collision.
+    bool hit = false;
+    if (compoundA) {
+        Vec2 positionA(floatData[_indexA * FDATA_EPO + FDATA_X], floatData[_indexA * FDATA_EPO + FDATA_Y]);
+        const Vec2& axisA = shapes[_indexA].axisX;
+
+        queryCompound(*compoundA, toBodySpace(compoundB->bounds, positionA, axisA), [&](int childA) {
+            const ConvexGeometry& geometryA = compoundA->geometry[childA];
+            queryCompound(*compoundB, toBodySpace(geometryA.bounds, positionB, axisB), [&](int childB) {
+                _childA = childA;
+                _childB = childB;
+                hit |= _collideConvex(geometryA, compoundB->geometry[childB]);
+            });
+        });
+    }
+    else {
+        ConvexGeometry geometryA;
+        if (!_bodyGeometry(_indexA, geometryA)) return false;
+
+        queryCompound(*compoundB, toBodySpace(geometryA.bounds, positionB, axisB), [&](int childB) {
+            _childB = childB;
+            hit |= _collideConvex(geometryA, compoundB->geometry[childB]);
+        });
+    }
+
+    _childA = -1;
+    _childB = -1;
+    return hit;
+}
 
-        return std::make_pair(minProj, maxProj);
+// A tile rectangle as an outline, wound like a box.
+static void _rectGeometry(const Aabb& bounds, ConvexGeometry& geometry) {
+    geometry.vertexCount = 4;
+    geometry.radius = 0.0f;
+    geometry.vertices[0] = bounds.min;
+    geometry.vertices[1] = Vec2(bounds.max.x, bounds.min.y);
+    geometry.vertices[2] = bounds.max;
+    geometry.vertices[3] = Vec2(bounds.min.x, bounds.max.y);
+    geometry.normals[0] = Vec2(0.0f, -1.0f);
+    geometry.normals[1] = Vec2(1.0f, 0.0f);
+    geometry.normals[2] = Vec2(0.0f, 1.0f);
+    geometry.normals[3] = Vec2(-1.0f, 0.0f);
+    geometry.bounds = bounds;
+}
+
+bool CollisionSolver::solveTerrain(int index, const Tilemap& tilemap) {
+    _indexA = index;
+    _indexB = TERRAIN_INDEX;
+    _childA = -1;
+    _childB = -1;
+    _relativeVelocity = Vec2(-floatData[index * FDATA_EPO + FDATA_VX], -floatData[index * FDATA_EPO + FDATA_VY]);
+
+    const Compound* compound = shapes[index].compound;
+    ConvexGeometry body;
+    if (!compound && !_bodyGeometry(index, body)) return false;
+
+    bool hit = false;
+    ConvexGeometry tiles;
+    auto collideRect = [&](const ConvexGeometry& geometry, int rect) {
+        _childB = rect;
+        _rectGeometry(tilemap.rects[rect].bounds, tiles);
+
+        size_t count = collisions.size();
+        if (!_collideConvex(geometry, tiles)) return;
+
+        _filterTerrainContact(tilemap, tilemap.rects[rect]);
+        hit |= collisions.size() > count;
     };
 
-    // Check all axes for overlap (for both AABB and Box)
-    for (const Vec2& axis : axes) {
-        // Project AABB (Object A) onto the current axis
-        auto [minA, maxA] = projectAabbOntoAxis(xA, yA, wA, hA, axis);
+    if (compound) {
+        for (size_t child = 0; child < compound->children.size(); child++) {
+            _childA = static_cast<int>(child);
+            const ConvexGeometry& geometry = compound->geometry[child];
+            tilemap.query(geometry.bounds, [&](int rect) { collideRect(geometry, rect); });
+        }
+    }
+    else {
+        tilemap.query(body.bounds, [&](int rect) { collideRect(body, rect); });
+    }
+
+    _childA = -1;
+    _childB = -1;
+    return hit;
+}
 
-        // Project Box (Object B) onto the current axis
-        auto [minB, maxB] = projectBoxOntoAxis(xB, yB, wB, hB, rotationB, axis);
+// Merged rectangles still meet each other along internal faces. A contact whose normal (mostly)
+// faces a solid tile across such a face is a ghost and is dropped. A contact at a corner whose
+// normal only leans towards one is straightened onto the exposed face.
+void CollisionSolver::_filterTerrainContact(const Tilemap& tilemap, const TileRect& rect) {
+    CollisionInfo& collision = collisions.back();
+    const Aabb& bounds = rect.bounds;
+    Vec2 outward = -collision.normal;
+    bool alongX = fabs(outward.x) >= fabs(outward.y);
+    float sideX = outward.x > 0.0f ? 1.0f : -1.0f;
+    float sideY = outward.y > 0.0f ? 1.0f : -1.0f;
+    float faceX = sideX > 0.0f ? bounds.max.x : bounds.min.x;
+    float faceY = sideY > 0.0f ? bounds.max.y : bounds.min.y;
+
+    float inset = tilemap.tileSize * 0.001f;
+    float reach = tilemap.tileSize * 0.25f;
+    float probe = tilemap.tileSize * 0.5f;
+
+    bool straighten = false;
+    int pointCount = 0;
+    for (int i = 0; i < collision.pointCount; i++) {
+        Vec2 p(clamp(collision.points[i].point.x, bounds.min.x + inset, bounds.max.x - inset),
+               clamp(collision.points[i].point.y, bounds.min.y + inset, bounds.max.y - inset));
+
+        bool internalX = fabs(outward.x) > 0.01f && fabs(p.x - faceX) < reach && tilemap.isSolidAt(Vec2(faceX + sideX * probe, p.y));
+        bool internalY = fabs(outward.y) > 0.01f && fabs(p.y - faceY) < reach && tilemap.isSolidAt(Vec2(p.x, faceY + sideY * probe));
+
+        if (alongX ? internalX : internalY) continue;
+        straighten |= alongX ? internalY : internalX;
+        collision.points[pointCount++] = collision.points[i];
+    }
 
-        // Check for overlap between projections
-        if (maxA < minB || maxB < minA) {
-            // No overlap on this axis, so there is a separating axis -> no collision
-            return false;
+    if (pointCount == 0) {
+        collisions.pop_back();
+        return;
+    }
+
+    if (straighten) collision.normal = alongX ? Vec2(-sideX, 0.0f) : Vec2(0.0f, -sideY);
+
+    collision.pointCount = pointCount;
+    Vec2 contactPoint;
+    float penetrationDepth = 0.0f;
+    for (int i = 0; i < pointCount; i++) {
+        contactPoint = contactPoint + collision.points[i].point;
+        penetrationDepth = max(penetrationDepth, collision.points[i].penetrationDepth);
+    }
+    collision.contactPoint = contactPoint / static_cast<float>(pointCount);
+    collision.penetrationDepth = penetrationDepth;
+}
+
+// Find the edge of polygon 1 with the largest separation from polygon 2.
+// Separation of polygon 2 from edge i of polygon 1: the deepest point of polygon 2 along -n.
+static float _edgeSeparation(int i, const Vec2* vertices1, const Vec2* normals1, const Vec2* vertices2, int count2) {
+    const Vec2& n = normals1[i];
+    const Vec2& v1 = vertices1[i];
+
+    float separation = FLT_MAX;
+    for (int j = 0; j < count2; j++) {
+        float sj = n.dot(vertices2[j] - v1);
+        if (sj < separation) separation = sj;
+    }
+    return separation;
+}
+
+// Edge of polygon 1 with the largest separation. The search starts at firstEdge, which wins ties.
+static float _findMaxSeparation(int& edgeIndex, int firstEdge, const Vec2* vertices1, const Vec2* normals1, int count1, const Vec2* vertices2, int count2) {
+    edgeIndex = firstEdge;
+    float maxSeparation = _edgeSeparation(firstEdge, vertices1, normals1, vertices2, count2);
+
+    for (int i = 0; i < count1; i++) {
+        if (i == firstEdge) continue;
+
+        float si = _edgeSeparation(i, vertices1, normals1, vertices2, count2);
+        if (si > maxSeparation) {
+            maxSeparation = si;
+            edgeIndex = i;
         }
+    }
+
+    return maxSeparation;
+}
+
+struct ClipVertex {
+    Vec2 v;
+    int id;
+};
+
+// Keep the part of the segment behind the plane dot(normal, x) = offset.
+static int _clipSegmentToLine(ClipVertex out[2], const ClipVertex in[2], const Vec2& normal, float offset, int clipId) {
+    int count = 0;
 
-        // Calculate the penetration depth on this axis
-        float overlap = std::min(maxA, maxB) - std::max(minA, minB);
-        if (overlap < minPenetrationDepth) {
-            minPenetrationDepth = overlap;
-            bestAxis = axis;
+    float distance0 = normal.dot(in[0].v) - offset;
+    float distance1 = normal.dot(in[1].v) - offset;
+
+    if (distance0 <= 0.0f) out[count++] = in[0];
+    if (distance1 <= 0.0f) out[count++] = in[1];
+
+    // The points are on different sides of the plane.
+    if (distance0 * distance1 < 0.0f) {
+        float interp = distance0 / (distance0 - distance1);
+        out[count].v = in[0].v + (in[1].v - in[0].v) * interp;
+        out[count].id = clipId;
+        count++;
+    }
+
+    return count;
+}
+
+bool CollisionSolver::_collidePolygons(const Vec2* verticesA, const Vec2* normalsA, int countA, float radiusA,
+                                       const Vec2* verticesB, const Vec2* normalsB, int countB, float radiusB) {
+    float totalRadius = radiusA + radiusB;
+
+    // Start from the axis this pair ended on last step. Its flip is relative to the object that
+    // was A then.
+    int idA = _idOf(_indexA);
+    int idB = _idOf(_indexB);
+    auto [cacheIt, isNew] = satCache.try_emplace(makeChildPairKey(idA, _childA, idB, _childB));
+    SatCacheEntry& cache = cacheIt->second;
+
+    int cachedFlip = cache.firstId == idA ? cache.flip : 1 - cache.flip;
+    int cachedEdge = cache.edge;
+    if (isNew || cachedEdge >= (cachedFlip ? countB : countA)) {
+        cachedFlip = 0;
+        cachedEdge = 0;
+    }
+
+    cache.firstId = idA;
+    cache.stamp = manifoldStamp + 1;
+
+    // A pair that was separated usually still is, on the same axis: one projection rejects it.
+    if (!isNew) {
+        float separation = cachedFlip
+            ? _edgeSeparation(cachedEdge, verticesB, normalsB, verticesA, countA)
+            : _edgeSeparation(cachedEdge, verticesA, normalsA, verticesB, countB);
+        if (separation > totalRadius) {
+            cache.edge = cachedEdge;
+            cache.flip = cachedFlip;
+            return false;
         }
     }
 
-    // If we get here, the AABB and Box are colliding on all axes
-    // Compute the vector from AABB to Box centers
-    Vec2 AB = Vec2(xB - xA, yB - yA);
+    int edgeA = 0;
+    float separationA = _findMaxSeparation(edgeA, cachedFlip ? 0 : cachedEdge, verticesA, normalsA, countA, verticesB, countB);
+    if (separationA > totalRadius) {
+        cache.edge = edgeA;
+        cache.flip = 0;
+        return false;
+    }
+
+    int edgeB = 0;
+    float separationB = _findMaxSeparation(edgeB, cachedFlip ? cachedEdge : 0, verticesB, normalsB, countB, verticesA, countA);
+    if (separationB > totalRadius) {
+        cache.edge = edgeB;
+        cache.flip = 1;
+        return false;
+    }
 
-    // Determine the correct normal direction
-    Vec2 normal;
-    if (AB.dot(bestAxis) > 0.0f) {
-        normal = bestAxis;
+    // Pick the reference polygon. Prefer A unless B is clearly better, so the choice doesn't flicker.
+    const Vec2* vertices1;
+    const Vec2* normals1;
+    int count1;
+    const Vec2* vertices2;
+    const Vec2* normals2;
+    int count2;
+    float radius1;
+    float radius2;
+    int edge1;
+    int flip;
+
+    if (separationB > separationA + 0.0005f) {
+        vertices1 = verticesB; normals1 = normalsB; count1 = countB;
+        vertices2 = verticesA; normals2 = normalsA; count2 = countA;
+        radius1 = radiusB; radius2 = radiusA;
+        edge1 = edgeB;
+        flip = 1;
     } else {
-        normal = -bestAxis;
+        vertices1 = verticesA; normals1 = normalsA; count1 = countA;
+        vertices2 = verticesB; normals2 = normalsB; count2 = countB;
+        radius1 = radiusA; radius2 = radiusB;
+        edge1 = edgeA;
+        flip = 0;
     }
 
-    // Compute the contact point (optional, approximate it)
-    Vec2 contactPoint = Vec2((xA + xB) / 2.0f, (yA + yB) / 2.0f);  // Midpoint approximation
+    cache.edge = edge1;
+    cache.flip = flip;
+
+    // Find the incident edge on polygon 2: the one most anti-parallel to the reference normal.
+    const Vec2& referenceNormal = normals1[edge1];
+    int incidentEdge = 0;
+    float minDot = FLT_MAX;
+    for (int i = 0; i < count2; i++) {
+        float d = referenceNormal.dot(normals2[i]);
+        if (d < minDot) {
+            minDot = d;
+            incidentEdge = i;
+        }
+    }
 
-    // Store the collision info
-    collisions.push_back(CollisionInfo{
-        true,                      // Collision detected
-        contactPoint,              // Contact point
-        normal,                    // Collision normal
-        minPenetrationDepth,       // Penetration depth
-        _indexA,                   // Object A index (AABB)
-        _indexB,                   // Object B index (Box)
-        _relativeVelocity,         // Relative velocity (already computed)
-        0.0f                       // Friction placeholder (can be computed later)
-    });
+    int i1 = incidentEdge;
+    int i2 = (i1 + 1 < count2) ? i1 + 1 : 0;
+    ClipVertex incident[2] = {
+        {vertices2[i1], i1},
+        {vertices2[i2], i2}
+    };
 
-    return true;
-}
+    const Vec2& v11 = vertices1[edge1];
+    const Vec2& v12 = vertices1[(edge1 + 1 < count1) ? edge1 + 1 : 0];
 
-bool CollisionSolver::_solveCircleBox() {
-    // Get Circle (Object A) data
-    float rA = floatData[_indexA * FDATA_EPO + FDATA_RADIUS];
-    float xA = floatData[_indexA * FDATA_EPO + FDATA_X];
-    float yA = floatData[_indexA * FDATA_EPO + FDATA_Y];
+    Vec2 tangent = (v12 - v11).normalize();
+    float frontOffset = referenceNormal.dot(v11);
+    float sideOffset1 = -tangent.dot(v11) + totalRadius;
+    float sideOffset2 = tangent.dot(v12) + totalRadius;
 
-    // Get Box (Object B) data
-    float xB = floatData[_indexB * FDATA_EPO + FDATA_X];
-    float yB = floatData[_indexB * FDATA_EPO + FDATA_Y];
-    float wB = floatData[_indexB * FDATA_EPO + FDATA_W];
-    float hB = floatData[_indexB * FDATA_EPO + FDATA_H];
-    float rotationB = floatData[_indexB * FDATA_EPO + FDATA_R];
+    // Clip the incident edge against the side planes of the reference edge.
+    ClipVertex clipPoints1[2];
+    ClipVertex clipPoints2[2];
+    if (_clipSegmentToLine(clipPoints1, incident, -tangent, sideOffset1, 0x80 | 0) < 2) return false;
+    if (_clipSegmentToLine(clipPoints2, clipPoints1, tangent, sideOffset2, 0x80 | 1) < 2) return false;
 
-    // Compute the relative position of the circle's center to the box's center
-    Vec2 circleCenter(xA, yA);
-    Vec2 boxCenter(xB, yB);
-    Vec2 relCircleCenter = circleCenter - boxCenter;
+    Vec2 normal = flip ? -referenceNormal : referenceNormal;
 
-    // Rotate the relative position into the box's local space (unrotate the box)
-    Vec2 localCircleCenter = relCircleCenter.rotate(-rotationB);
+    ContactPoint points[MAX_MANIFOLD_POINTS];
+    int pointCount = 0;
 
-    // Box half-extents
-    float halfW = wB / 2.0f;
-    float halfH = hB / 2.0f;
+    for (int i = 0; i < MAX_MANIFOLD_POINTS; i++) {
+        float separation = referenceNormal.dot(clipPoints2[i].v) - frontOffset;
 
-    // Find the closest point on the box to the circle in the box's local space
-    float closestX = max(-halfW, min(localCircleCenter.x, halfW));
-    float closestY = max(-halfH, min(localCircleCenter.y, halfH));
+        if (separation <= totalRadius) {
+            ContactPoint& cp = points[pointCount++];
 
-    // Compute the distance vector between the circle's center and the closest point
-    Vec2 closestPointLocal(closestX, closestY);
-    Vec2 distanceVecLocal = closestPointLocal - localCircleCenter;
+            // Halfway between the two surfaces.
+            cp.point = clipPoints2[i].v - referenceNormal * ((separation + radius2 - radius1) * 0.5f);
+            cp.penetrationDepth = totalRadius - separation;
+            cp.featureId = (flip << 16) | (edge1 << 8) | clipPoints2[i].id;
+            cp.normalImpulse = 0.0f;
+            cp.tangentImpulse = 0.0f;
+        }
+    }
 
-    // Calculate the squared distance
-    float distanceSquared = distanceVecLocal.magnitudeSquared();
+    if (pointCount == 0) return false;
 
-    // Check if the distance squared is less than the circle's radius squared
-    if (distanceSquared < rA * rA) {
-        // Compute the penetration depth
-        float distance = sqrt(distanceSquared);
-        float penetrationDepth = rA - distance;
-
-        // Compute the collision normal in local space
-        Vec2 normalLocal = (distance == 0) ? Vec2(1.0f, 0.0f) : distanceVecLocal / distance;
-
-        // Rotate the normal back to world space
-        Vec2 normal = normalLocal.rotate(rotationB);
-
-        // Find the closest point in world space
-        Vec2 closestPointWorld = closestPointLocal.rotate(rotationB) + boxCenter;
-
-        // Store the collision info
-        collisions.push_back(CollisionInfo{
-            true,                      // Collision detected
-            closestPointWorld,          // Contact point
-            normal,                    // Collision normal
-            penetrationDepth,           // Penetration depth
-            _indexA,                   // Object A index (Circle)
-            _indexB,                   // Object B index (Box)
-            _relativeVelocity,         // Relative velocity (already computed)
-            0.0f                       // Friction placeholder (can be computed later)
-        });
+    _addCollision(normal, points, pointCount);
 
-        return true;
+    return true;
+}
+
+void CollisionSolver::_addCollision(const Vec2& normal, const ContactPoint* points, int pointCount) {
+    CollisionInfo info;
+    info.isColliding = true;
+    info.normal = normal;
+    info.indexA = _indexA;
+    info.indexB = _indexB;
+    info.childA = _childA;
+    info.childB = _childB;
+    info.relativeVelocity = _relativeVelocity;
+    info.normalImpulseMagnitude = 0.0f;
+    info.pointCount = pointCount;
+    info.key = 0;
+    info.manifold = nullptr;
+
+    // The single point summary is the average point and the deepest penetration.
+    Vec2 contactPoint;
+    float penetrationDepth = 0.0f;
+    for (int i = 0; i < pointCount; i++) {
+        info.points[i] = points[i];
+        contactPoint = contactPoint + points[i].point;
+        penetrationDepth = max(penetrationDepth, points[i].penetrationDepth);
     }
+    info.contactPoint = contactPoint / static_cast<float>(pointCount);
+    info.penetrationDepth = penetrationDepth;
 
-    return false;  // No collision
+    collisions.push_back(info);
 }
 
+void CollisionSolver::updateManifolds() {
+    manifoldStamp++;
+    resetFrameVector(endedManifolds, frameArena);
+
+    for (auto& collision : collisions) {
+        int idA = _idOf(collision.indexA);
+        int idB = _idOf(collision.indexB);
+        collision.key = makeChildPairKey(idA, collision.childA, idB, collision.childB);
+
+        auto [it, isNew] = manifolds.try_emplace(collision.key);
+        ContactManifold& manifold = it->second;
+
+        if (isNew) manifold.firstStamp = manifoldStamp;
+        else {
+            // Carry the accumulated impulses over to points produced by the same features.
+            for (int i = 0; i < collision.pointCount; i++) {
+                ContactPoint& point = collision.points[i];
+                for (int j = 0; j < manifold.pointCount; j++) {
+                    if (manifold.points[j].featureId == point.featureId) {
+                        point.normalImpulse = manifold.points[j].normalImpulse;
+                        point.tangentImpulse = manifold.points[j].tangentImpulse;
+                        break;
+                    }
+                }
+            }
+        }
 
+        manifold.pointCount = collision.pointCount;
+        for (int i = 0; i < collision.pointCount; i++) {
+            manifold.points[i] = collision.points[i];
+        }
+        manifold.stamp = manifoldStamp;
+        manifold.idA = idA;
+        manifold.idB = idB;
+        manifold.normal = collision.normal;
+
+        collision.manifold = &manifold;
+    }
+
+    // Drop the manifolds of pairs that are no longer touching, and the SAT axes of pairs that
+    // are no longer tested.
+    for (auto it = manifolds.begin(); it != manifolds.end(); ) {
+        if (it->second.stamp != manifoldStamp) {
+            endedManifolds.push_back(it->second);
+            it = manifolds.erase(it);
+        }
+        else ++it;
+    }
+    for (auto it = satCache.begin(); it != satCache.end(); ) {
+        if (it->second.stamp != manifoldStamp) it = satCache.erase(it);
+        else ++it;
+    }
+
+    // Dropped pairs that touch again carry on from when they started, without their impulses.
+    for (auto& [key, dropped] : droppedManifolds) {
+        auto it = manifolds.find(key);
+        if (it != manifolds.end()) it->second.firstStamp = dropped.firstStamp;
+        else endedManifolds.push_back(dropped);
+    }
+    droppedManifolds.clear();
+}
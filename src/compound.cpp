@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include "compound.h"
+
+using namespace std;
+
+// Body space bounds of a child.
+static Aabb _childBounds(const CompoundChild& child) {
+    if (child.shape == ObjectShape::CIRCLE) {
+        Vec2 r(child.width, child.width);
+        return Aabb(child.offset - r, child.offset + r);
+    }
+
+    float c = fabs(cos(child.rotation));
+    float s = fabs(sin(child.rotation));
+    Vec2 half((child.width * c + child.height * s) / 2.0f, (child.width * s + child.height * c) / 2.0f);
+    return Aabb(child.offset - half, child.offset + half);
+}
+
+// Top-down build: split the children at the median of their centers along the wider axis.
+static int _buildNode(Compound& compound, vector<int>& indices, int begin, int end) {
+    int nodeIndex = static_cast<int>(compound.nodes.size());
+    compound.nodes.push_back(CompoundNode{Aabb(), -1, -1, -1});
+
+    Aabb bounds;
+    Aabb centers;
+    for (int i = begin; i < end; i++) {
+        Aabb childBounds = _childBounds(compound.children[indices[i]]);
+        bounds.mergeWith(childBounds);
+        centers.expandToInclude(childBounds.getCenter());
+    }
+    compound.nodes[nodeIndex].bounds = bounds;
+
+    if (end - begin == 1) {
+        compound.nodes[nodeIndex].child = indices[begin];
+        return nodeIndex;
+    }
+
+    bool splitX = centers.max.x - centers.min.x >= centers.max.y - centers.min.y;
+    int middle = (begin + end) / 2;
+    nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end, [&](int a, int b) {
+        Vec2 ca = _childBounds(compound.children[a]).getCenter();
+        Vec2 cb = _childBounds(compound.children[b]).getCenter();
+        return splitX ? ca.x < cb.x : ca.y < cb.y;
+    });
+
+    int left = _buildNode(compound, indices, begin, middle);
+    int right = _buildNode(compound, indices, middle, end);
+    compound.nodes[nodeIndex].left = left;
+    compound.nodes[nodeIndex].right = right;
+    return nodeIndex;
+}
+
+bool buildCompound(const vector<float>& childData, Compound& compound) {
+    int count = static_cast<int>(childData.size() / COMPOUND_CHILD_EPO);
+    if (count == 0 || childData.size() % COMPOUND_CHILD_EPO != 0) return false;
+
+    compound.children.clear();
+    compound.nodes.clear();
+    compound.mass = 0.0f;
+
+    Vec2 weighted;
+    for (int i = 0; i < count; i++) {
+        const float* data = &childData[i * COMPOUND_CHILD_EPO];
+        ObjectShape shape = static_cast<ObjectShape>(static_cast<int>(data[0]));
+        if (shape != ObjectShape::CIRCLE && shape != ObjectShape::BOX) return false;
+
+        CompoundChild child{shape, Vec2(data[1], data[2]), data[3], data[4], data[5], max(0.0f, data[6])};
+        compound.children.push_back(child);
+        compound.mass += child.mass;
+        weighted = weighted + child.offset * child.mass;
+    }
+
+    compound.centerOfMass = compound.mass > 0.0f ? weighted / compound.mass : Vec2();
+    for (auto& child : compound.children) child.offset = child.offset - compound.centerOfMass;
+
+    // A balanced tree over n leaves has 2n - 1 nodes and fits the query stack for any sane n.
+    vector<int> indices(count);
+    for (int i = 0; i < count; i++) indices[i] = i;
+    compound.nodes.reserve(count * 2 - 1);
+    _buildNode(compound, indices, 0, count);
+
+    compound.geometry.resize(count);
+    return true;
+}
+
+void updateCompoundGeometry(Compound& compound, const Vec2& position, const Vec2& axisX) {
+    Vec2 axisY(-axisX.y, axisX.x);
+    compound.bounds = Aabb();
+
+    for (size_t i = 0; i < compound.children.size(); i++) {
+        const CompoundChild& child = compound.children[i];
+        ConvexGeometry& geometry = compound.geometry[i];
+        Vec2 center = position + axisX * child.offset.x + axisY * child.offset.y;
+
+        if (child.shape == ObjectShape::CIRCLE) {
+            geometry.vertexCount = 1;
+            geometry.radius = child.width;
+            geometry.vertices[0] = center;
+            geometry.bounds = Aabb(center - Vec2(child.width, child.width), center + Vec2(child.width, child.width));
+        }
+        else {
+            // The child's axes, rotated by the body.
+            float c = cos(child.rotation);
+            float s = sin(child.rotation);
+            Vec2 childX = axisX * c + axisY * s;
+            Vec2 childY(-childX.y, childX.x);
+            Vec2 halfX = childX * (child.width / 2.0f);
+            Vec2 halfY = childY * (child.height / 2.0f);
+
+            geometry.vertexCount = 4;
+            geometry.radius = 0.0f;
+            geometry.vertices[0] = center - halfX - halfY;
+            geometry.vertices[1] = center + halfX - halfY;
+            geometry.vertices[2] = center + halfX + halfY;
+            geometry.vertices[3] = center - halfX + halfY;
+            geometry.normals[0] = -childY;
+            geometry.normals[1] = childX;
+            geometry.normals[2] = childY;
+            geometry.normals[3] = -childX;
+
+            geometry.bounds = Aabb();
+            for (int j = 0; j < 4; j++) geometry.bounds.expandToInclude(geometry.vertices[j]);
+        }
+
+        compound.bounds.mergeWith(geometry.bounds);
+    }
+}
+
+Aabb toBodySpace(const Aabb& worldBounds, const Vec2& position, const Vec2& axisX) {
+    Vec2 center = worldBounds.getCenter() - position;
+    Vec2 extents = worldBounds.getExtents();
+
+    Vec2 localCenter(center.dot(axisX), center.x * -axisX.y + center.y * axisX.x);
+    float c = fabs(axisX.x);
+    float s = fabs(axisX.y);
+    Vec2 localExtents(extents.x * c + extents.y * s, extents.x * s + extents.y * c);
+    return Aabb(localCenter - localExtents, localCenter + localExtents);
+}
@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cmath>
+#include "impulse-solver.h"
+
+using namespace std;
+
+// Closing speeds below this are treated as resting contact (no bounce).
+static const float RESTITUTION_THRESHOLD = 0.5f;
+// Tangential speeds below this use the static friction coefficient.
+static const float STATIC_FRICTION_THRESHOLD = 0.001f;
+
+// Fraction of the remaining penetration removed per position iteration.
+static const float BAUMGARTE = 0.2f;
+// Penetration allowed to remain so that resting contacts stay in contact.
+static const float LINEAR_SLOP = 0.005f;
+static const float MAX_LINEAR_CORRECTION = 0.2f;
+
+// Soft contact stiffness for substepping, capped at a quarter of the substep rate.
+static const float CONTACT_HERTZ = 30.0f;
+static const float CONTACT_DAMPING_RATIO = 10.0f;
+// Fastest speed at which the soft bias pushes overlapping bodies apart.
+static const float MAX_PUSH_VELOCITY = 3.0f;
+
+// One bit per color in a body's color mask. Constraints that don't fit go to a serial batch.
+static const int MAX_COLORS = 64;
+
+ImpulseSolver::ImpulseSolver(vector<int>& intData, vector<float>& floatData)
+    : intData(intData), floatData(floatData)
+{
+    fill(terrainData, terrainData + FDATA_EPO, 0.0f);
+    terrainData[FDATA_COS] = 1.0f;
+}
+
+void ImpulseSolver::clear() {
+    resetFrameVector(constraints, frameArena);
+}
+
+void ImpulseSolver::solve(FrameVector<CollisionInfo>& collisions) {
+    _prepare(collisions);
+    _colorConstraints();
+
+    if(hasWarmStarting) _warmStart();
+
+    auto solveVelocities = [this](int begin, int end){ _solveVelocities(begin, end); };
+    for(int i = 0; i < velocityIterations; i++){
+        _forEachBatch(solveVelocities);
+    }
+
+    _storeImpulses();
+
+    if(hasPenetrationResolution){
+        auto solvePositions = [this](int begin, int end){ _solvePositions(begin, end); };
+        for(int i = 0; i < positionIterations; i++){
+            _forEachBatch(solvePositions);
+        }
+    }
+}
+
+void ImpulseSolver::beginSubsteps(FrameVector<CollisionInfo>& collisions, float substepTime, int substepCount) {
+    _prepare(collisions);
+    _colorConstraints();
+
+    // Stored impulses are per step. Each substep applies its own share.
+    _substepCount = substepCount;
+    for (auto& c : constraints) {
+        c.normalImpulse /= substepCount;
+        c.tangentImpulse /= substepCount;
+    }
+
+    float hertz = min(CONTACT_HERTZ, 0.25f / substepTime);
+    float omega = 2.0f * static_cast<float>(M_PI) * hertz;
+    float a1 = 2.0f * CONTACT_DAMPING_RATIO + substepTime * omega;
+    float a2 = substepTime * omega * a1;
+    float a3 = 1.0f / (1.0f + a2);
+
+    _inverseSubstepTime = 1.0f / substepTime;
+    _biasRate = omega / a1;
+    _massScale = a2 * a3;
+    _impulseScale = a3;
+}
+
+void ImpulseSolver::solveSubstep(bool useBias) {
+    if(useBias && hasWarmStarting) _warmStart();
+
+    _forEachBatch([this, useBias](int begin, int end){ _solveSoft(begin, end, useBias); });
+}
+
+void ImpulseSolver::endSubsteps() {
+    if(hasRestitution){
+        _forEachBatch([this](int begin, int end){ _applyRestitution(begin, end); });
+    }
+
+    _storeImpulses(static_cast<float>(_substepCount));
+}
+
+// Greedy graph coloring. Two constraints get different colors if they share a dynamic body, so
+// the constraints of one color can be solved concurrently. Static bodies are never written to and
+// don't need to be exclusive.
+void ImpulseSolver::_colorConstraints() {
+    resetFrameVector(batchOffsets, frameArena);
+    int count = static_cast<int>(constraints.size());
+
+    if(workerPool.getThreadCount() <= 1 || count < workerPool.minParallelCount){
+        // Serial solve: a single batch in narrow phase order.
+        batchOffsets.push_back(0);
+        batchOffsets.push_back(count);
+        return;
+    }
+
+    resetFrameVector(_bodyColors, frameArena);
+    resetFrameVector(_constraintColors, frameArena);
+    resetFrameVector(_sortedConstraints, frameArena);
+    _bodyColors.assign(floatData.size() / FDATA_EPO, 0);
+    _constraintColors.resize(count);
+
+    int colorCounts[MAX_COLORS + 1] = {0};
+
+    for (int i = 0; i < count; i++) {
+        ContactConstraint& c = constraints[i];
+        uint64_t used = 0;
+        if(c.invMassA != 0.0f) used |= _bodyColors[c.indexA];
+        if(c.invMassB != 0.0f) used |= _bodyColors[c.indexB];
+
+        int color = MAX_COLORS;
+        if(used != ~0ULL){
+            color = __builtin_ctzll(~used);
+            uint64_t bit = 1ULL << color;
+            if(c.invMassA != 0.0f) _bodyColors[c.indexA] |= bit;
+            if(c.invMassB != 0.0f) _bodyColors[c.indexB] |= bit;
+        }
+
+        _constraintColors[i] = color;
+        colorCounts[color]++;
+    }
+
+    // Counting sort the constraints by color.
+    int offsets[MAX_COLORS + 1];
+    int offset = 0;
+    for (int color = 0; color <= MAX_COLORS; color++) {
+        offsets[color] = offset;
+        if(colorCounts[color] > 0) batchOffsets.push_back(offset);
+        offset += colorCounts[color];
+    }
+    batchOffsets.push_back(count);
+
+    _sortedConstraints.resize(count);
+    for (int i = 0; i < count; i++) {
+        _sortedConstraints[offsets[_constraintColors[i]]++] = constraints[i];
+    }
+    constraints.swap(_sortedConstraints);
+
+    // Keep the uncolored constraints in their own (serial) batch, even if it's empty.
+    if(colorCounts[MAX_COLORS] == 0) batchOffsets.push_back(count);
+}
+
+void ImpulseSolver::_forEachBatch(const function<void(int, int)>& fn) {
+    int batchCount = static_cast<int>(batchOffsets.size()) - 1;
+
+    for (int b = 0; b < batchCount; b++) {
+        int begin = batchOffsets[b];
+        int end = batchOffsets[b + 1];
+        if(begin == end) continue;
+
+        if(b == batchCount - 1 && batchCount > 1){
+            fn(begin, end);
+            continue;
+        }
+
+        workerPool.parallelFor(end - begin, [&](int chunkBegin, int chunkEnd){
+            fn(begin + chunkBegin, begin + chunkEnd);
+        });
+    }
+}
+
+void ImpulseSolver::_prepare(FrameVector<CollisionInfo>& collisions) {
+    resetFrameVector(constraints, frameArena);
+    constraints.reserve(collisions.size() * MAX_MANIFOLD_POINTS);
+
+    static const MaterialTable defaultMaterials;
+    const MaterialTable& table = materials ? *materials : defaultMaterials;
+
+    for (auto& collision : collisions) {
+        float* a = &floatData[collision.indexA * FDATA_EPO];
+        float* b = _body(collision.indexB);
+
+        bool fixedA = intData[collision.indexA * LIVE_INT_EPO + LIVE_INT_TYPE] == static_cast<int>(ObjectType::FIXED_OBJECT);
+        bool fixedB = collision.indexB == TERRAIN_INDEX
+            || intData[collision.indexB * LIVE_INT_EPO + LIVE_INT_TYPE] == static_cast<int>(ObjectType::FIXED_OBJECT);
+        float invMassA = fixedA ? 0.0f : a[FDATA_IM];
+        float invMassB = fixedB ? 0.0f : b[FDATA_IM];
+
+        Vec2 positionA = Vec2(a[FDATA_X], a[FDATA_Y]);
+        Vec2 positionB = Vec2(b[FDATA_X], b[FDATA_Y]);
+        Vec2 velocityA = Vec2(a[FDATA_VX], a[FDATA_VY]);
+        Vec2 velocityB = Vec2(b[FDATA_VX], b[FDATA_VY]);
+        float wA = a[FDATA_RS];
+        float wB = b[FDATA_RS];
+
+        const MaterialPair& material = table.pair(_material(collision.indexA), _material(collision.indexB));
+
+        collision.normalImpulseMagnitude = 0.0f;
+
+        for (int p = 0; p < collision.pointCount; p++) {
+            ContactPoint& point = collision.points[p];
+
+            ContactConstraint c;
+            c.collision = &collision;
+            c.pointIndex = p;
+            c.indexA = collision.indexA;
+            c.indexB = collision.indexB;
+            c.invMassA = invMassA;
+            c.invMassB = invMassB;
+
+            // Temporary approximation for moment of inertia (same as PhysicalObject::applyImpulse).
+            c.invInertiaA = invMassA;
+            c.invInertiaB = invMassB;
+
+            c.normal = collision.normal;
+            c.tangent = Vec2(-c.normal.y, c.normal.x);
+
+            c.startPositionA = positionA;
+            c.startPositionB = positionB;
+            c.rA = point.point - positionA;
+            c.rB = point.point - positionB;
+            c.penetrationDepth = point.penetrationDepth;
+
+            float rnA = c.rA.cross(c.normal);
+            float rnB = c.rB.cross(c.normal);
+            float kNormal = c.invMassA + c.invMassB + c.invInertiaA * rnA * rnA + c.invInertiaB * rnB * rnB;
+            c.normalMass = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+
+            float rtA = c.rA.cross(c.tangent);
+            float rtB = c.rB.cross(c.tangent);
+            float kTangent = c.invMassA + c.invMassB + c.invInertiaA * rtA * rtA + c.invInertiaB * rtB * rtB;
+            c.tangentMass = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+
+            // Relative velocity at the contact point.
+            Vec2 dv = velocityB + Vec2(-wB * c.rB.y, wB * c.rB.x) - velocityA - Vec2(-wA * c.rA.y, wA * c.rA.x);
+            float vn = dv.dot(c.normal);
+            float vt = dv.dot(c.tangent);
+
+            c.velocityBias = 0.0f;
+            if(hasRestitution && vn < -RESTITUTION_THRESHOLD){
+                c.velocityBias = -material.restitution * vn;
+            }
+
+            c.friction = fabs(vt) < STATIC_FRICTION_THRESHOLD ? material.staticFriction : material.kineticFriction;
+
+            // The manifold update has already carried over the impulses of matching points.
+            c.normalImpulse = hasWarmStarting ? point.normalImpulse : 0.0f;
+            c.tangentImpulse = hasWarmStarting && hasFriction ? point.tangentImpulse : 0.0f;
+
+            constraints.push_back(c);
+        }
+    }
+}
+
+// Apply an impulse to B and the opposite impulse to A, at the contact point.
+void ImpulseSolver::__applyImpulse(ContactConstraint& c, const Vec2& impulse) {
+    float* a = &floatData[c.indexA * FDATA_EPO];
+    float* b = _body(c.indexB);
+
+    // Static bodies are shared between parallel batches, so they must never be written to.
+    if(c.invMassA != 0.0f){
+        a[FDATA_VX] -= impulse.x * c.invMassA;
+        a[FDATA_VY] -= impulse.y * c.invMassA;
+        a[FDATA_RS] -= c.rA.cross(impulse) * c.invInertiaA;
+    }
+
+    if(c.invMassB != 0.0f){
+        b[FDATA_VX] += impulse.x * c.invMassB;
+        b[FDATA_VY] += impulse.y * c.invMassB;
+        b[FDATA_RS] += c.rB.cross(impulse) * c.invInertiaB;
+    }
+}
+
+void ImpulseSolver::_warmStart() {
+    for (auto& c : constraints) {
+        if(c.normalImpulse == 0.0f && c.tangentImpulse == 0.0f) continue;
+        __applyImpulse(c, c.normal * c.normalImpulse + c.tangent * c.tangentImpulse);
+    }
+}
+
+void ImpulseSolver::_solveVelocities(int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        ContactConstraint& c = constraints[i];
+        float* a = &floatData[c.indexA * FDATA_EPO];
+        float* b = _body(c.indexB);
+
+        // Friction first, so that the normal constraint has the final say.
+        if(hasFriction){
+            float wA = a[FDATA_RS];
+            float wB = b[FDATA_RS];
+            Vec2 dv = Vec2(b[FDATA_VX] - wB * c.rB.y, b[FDATA_VY] + wB * c.rB.x)
+                - Vec2(a[FDATA_VX] - wA * c.rA.y, a[FDATA_VY] + wA * c.rA.x);
+
+            float lambda = -dv.dot(c.tangent) * c.tangentMass;
+            float maxFriction = c.friction * c.normalImpulse;
+            float newImpulse = max(-maxFriction, min(c.tangentImpulse + lambda, maxFriction));
+            lambda = newImpulse - c.tangentImpulse;
+            c.tangentImpulse = newImpulse;
+
+            __applyImpulse(c, c.tangent * lambda);
+        }
+
+        float wA = a[FDATA_RS];
+        float wB = b[FDATA_RS];
+        Vec2 dv = Vec2(b[FDATA_VX] - wB * c.rB.y, b[FDATA_VY] + wB * c.rB.x)
+            - Vec2(a[FDATA_VX] - wA * c.rA.y, a[FDATA_VY] + wA * c.rA.x);
+
+        float lambda = -c.normalMass * (dv.dot(c.normal) - c.velocityBias);
+        float newImpulse = max(c.normalImpulse + lambda, 0.0f);
+        lambda = newImpulse - c.normalImpulse;
+        c.normalImpulse = newImpulse;
+
+        __applyImpulse(c, c.normal * lambda);
+    }
+}
+
+// Velocity iteration with a soft positional bias.
+// Separation is tracked from the body displacement since the narrow phase. Open contacts only stop
+// the gap from closing faster than one substep allows (speculative contact). Overlapping contacts
+// are pushed apart softly when useBias is set, and only held in place by the relax pass.
+void ImpulseSolver::_solveSoft(int begin, int end, bool useBias) {
+    for (int i = begin; i < end; i++) {
+        ContactConstraint& c = constraints[i];
+        float* a = &floatData[c.indexA * FDATA_EPO];
+        float* b = _body(c.indexB);
+
+        if(hasFriction){
+            float wA = a[FDATA_RS];
+            float wB = b[FDATA_RS];
+            Vec2 dv = Vec2(b[FDATA_VX] - wB * c.rB.y, b[FDATA_VY] + wB * c.rB.x)
+                - Vec2(a[FDATA_VX] - wA * c.rA.y, a[FDATA_VY] + wA * c.rA.x);
+
+            float lambda = -dv.dot(c.tangent) * c.tangentMass;
+            float maxFriction = c.friction * c.normalImpulse;
+            float newImpulse = max(-maxFriction, min(c.tangentImpulse + lambda, maxFriction));
+            lambda = newImpulse - c.tangentImpulse;
+            c.tangentImpulse = newImpulse;
+
+            __applyImpulse(c, c.tangent * lambda);
+        }
+
+        Vec2 dpA = Vec2(a[FDATA_X], a[FDATA_Y]) - c.startPositionA;
+        Vec2 dpB = Vec2(b[FDATA_X], b[FDATA_Y]) - c.startPositionB;
+        float separation = (dpB - dpA).dot(c.normal) - c.penetrationDepth + LINEAR_SLOP;
+
+        float bias = 0.0f;
+        float massScale = 1.0f;
+        float impulseScale = 0.0f;
+        if(separation > 0.0f){
+            bias = separation * _inverseSubstepTime;
+        }
+        else if(useBias && hasPenetrationResolution){
+            bias = max(_biasRate * separation, -MAX_PUSH_VELOCITY);
+            massScale = _massScale;
+            impulseScale = _impulseScale;
+        }
+
+        float wA = a[FDATA_RS];
+        float wB = b[FDATA_RS];
+        Vec2 dv = Vec2(b[FDATA_VX] - wB * c.rB.y, b[FDATA_VY] + wB * c.rB.x)
+            - Vec2(a[FDATA_VX] - wA * c.rA.y, a[FDATA_VY] + wA * c.rA.x);
+
+        float lambda = -c.normalMass * massScale * (dv.dot(c.normal) + bias) - impulseScale * c.normalImpulse;
+        float newImpulse = max(c.normalImpulse + lambda, 0.0f);
+        lambda = newImpulse - c.normalImpulse;
+        c.normalImpulse = newImpulse;
+
+        __applyImpulse(c, c.normal * lambda);
+    }
+}
+
+// Restitution is applied once after the substeps, to contacts that were closing fast enough.
+void ImpulseSolver::_applyRestitution(int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        ContactConstraint& c = constraints[i];
+        if(c.velocityBias == 0.0f || c.normalImpulse == 0.0f) continue;
+
+        float* a = &floatData[c.indexA * FDATA_EPO];
+        float* b = _body(c.indexB);
+        float wA = a[FDATA_RS];
+        float wB = b[FDATA_RS];
+        Vec2 dv = Vec2(b[FDATA_VX] - wB * c.rB.y, b[FDATA_VY] + wB * c.rB.x)
+            - Vec2(a[FDATA_VX] - wA * c.rA.y, a[FDATA_VY] + wA * c.rA.x);
+
+        float lambda = -c.normalMass * (dv.dot(c.normal) - c.velocityBias);
+        float newImpulse = max(c.normalImpulse + lambda, 0.0f);
+        lambda = newImpulse - c.normalImpulse;
+        c.normalImpulse = newImpulse;
+
+        __applyImpulse(c, c.normal * lambda);
+    }
+}
+
+// Linear position correction. Rotation is left to the velocity solver.
+void ImpulseSolver::_solvePositions(int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        ContactConstraint& c = constraints[i];
+        float totalInverseMass = c.invMassA + c.invMassB;
+        if(totalInverseMass == 0.0f) continue;
+
+        float* a = &floatData[c.indexA * FDATA_EPO];
+        float* b = _body(c.indexB);
+
+        Vec2 dpA = Vec2(a[FDATA_X], a[FDATA_Y]) - c.startPositionA;
+        Vec2 dpB = Vec2(b[FDATA_X], b[FDATA_Y]) - c.startPositionB;
+        float separation = (dpB - dpA).dot(c.normal) - c.penetrationDepth;
+
+        float C = max(-MAX_LINEAR_CORRECTION, min(BAUMGARTE * (separation + LINEAR_SLOP), 0.0f));
+        if(C == 0.0f) continue;
+
+        Vec2 correction = c.normal * (-C / totalInverseMass);
+
+        if(c.invMassA != 0.0f){
+            a[FDATA_X] -= correction.x * c.invMassA;
+            a[FDATA_Y] -= correction.y * c.invMassA;
+        }
+        if(c.invMassB != 0.0f){
+            b[FDATA_X] += correction.x * c.invMassB;
+            b[FDATA_Y] += correction.y * c.invMassB;
+        }
+    }
+}
+
+// Write the accumulated impulses back to the contacts and their manifolds for the next step.
+// Substepped impulses are scaled back up to a whole step.
+void ImpulseSolver::_storeImpulses(float scale) {
+    for (auto& c : constraints) {
+        c.normalImpulse *= scale;
+        c.tangentImpulse *= scale;
+
+        CollisionInfo& collision = *c.collision;
+        ContactPoint& point = collision.points[c.pointIndex];
+
+        collision.normalImpulseMagnitude += c.normalImpulse;
+
+        point.normalImpulse = c.normalImpulse;
+        point.tangentImpulse = c.tangentImpulse;
+        if(collision.manifold){
+            collision.manifold->points[c.pointIndex].normalImpulse = c.normalImpulse;
+            collision.manifold->points[c.pointIndex].tangentImpulse = c.tangentImpulse;
+        }
+
+        // ix and iy are for visual debugging.
+        Vec2 impulse = c.normal * c.normalImpulse + c.tangent * c.tangentImpulse;
+        floatData[c.indexA * FDATA_EPO + FDATA_IX] -= impulse.x;
+        floatData[c.indexA * FDATA_EPO + FDATA_IY] -= impulse.y;
+        if(c.indexB != TERRAIN_INDEX){
+            floatData[c.indexB * FDATA_EPO + FDATA_IX] += impulse.x;
+            floatData[c.indexB * FDATA_EPO + FDATA_IY] += impulse.y;
+        }
+    }
+}
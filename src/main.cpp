@@ -96,21 +96,88 @@ EMSCRIPTEN_BINDINGS(general) {
 
 // }
 
+EMSCRIPTEN_BINDINGS(memory_stats) {
+    emscripten::value_object<SubsystemMemory>("SubsystemMemory")
+        .field("used", &SubsystemMemory::used)
+        .field("reserved", &SubsystemMemory::reserved)
+        .field("highWater", &SubsystemMemory::highWater);
+
+    emscripten::value_object<MemoryStats>("MemoryStats")
+        .field("objects", &MemoryStats::objects)
+        .field("bvh", &MemoryStats::bvh)
+        .field("contacts", &MemoryStats::contacts)
+        .field("frameArena", &MemoryStats::frameArena)
+        .field("lookup", &MemoryStats::lookup)
+        .field("events", &MemoryStats::events)
+        .field("staging", &MemoryStats::staging)
+        .field("shapes", &MemoryStats::shapes)
+        .field("total", &MemoryStats::total);
+}
+
+EMSCRIPTEN_BINDINGS(material) {
+    emscripten::value_object<Material>("Material")
+        .field("restitution", &Material::restitution)
+        .field("sFriction", &Material::staticFriction)
+        .field("kFriction", &Material::kineticFriction)
+        .field("linearDamping", &Material::linearDamping)
+        .field("angularDamping", &Material::angularDamping);
+}
+
 EMSCRIPTEN_BINDINGS(world) {
     emscripten::class_<World>("World")
         .constructor<>()
         .function("findeIndexForObject", &World::findeIndexForObject)
         .function("getLiveFloatData", &World::getLiveFloatData, emscripten::allow_raw_pointers())
         .function("getLiveIntData", &World::getLiveIntData, emscripten::allow_raw_pointers())
+        .function("getRenderData", &World::getRenderData, emscripten::allow_raw_pointers())
+        .function("getEventIntData", &World::getEventIntData, emscripten::allow_raw_pointers())
+        .function("getEventFloatData", &World::getEventFloatData, emscripten::allow_raw_pointers())
+        .function("getSensorEnterData", &World::getSensorEnterData, emscripten::allow_raw_pointers())
+        .function("getSensorExitData", &World::getSensorExitData, emscripten::allow_raw_pointers())
+        .function("getSensorOverlaps", &World::getSensorOverlaps)
+        .function("getSlotIndices", &World::getSlotIndices, emscripten::allow_raw_pointers())
         // .function("getIds", &World::getIds, emscripten::allow_raw_pointers())
         // .property("liveData", &World::liveData, emscripten::allow_raw_pointers())
         // .property("ids", &World::ids)
 
-        .function("makeObject", &World::makeObject)
+        .function("makeObject", emscripten::select_overload<uint32_t(int, emscripten_val)>(&World::makeObject))
+        .function("setStagingCapacity", &World::setStagingCapacity)
+        .function("getStagingCapacity", &World::getStagingCapacity)
+        .function("makeObjects", &World::makeObjects)
+        .function("getStagingFloatData", &World::getStagingFloatData, emscripten::allow_raw_pointers())
+        .function("getStagingIntData", &World::getStagingIntData, emscripten::allow_raw_pointers())
+        .function("getStagingHandles", &World::getStagingHandles, emscripten::allow_raw_pointers())
         .function("removeObject", &World::removeObject)
+        .function("removeObjectByHandle", &World::removeObjectByHandle)
+        .function("setPolygon", emscripten::optional_override([](World& world, int id, emscripten::val points) {
+            return world.setPolygon(id, emscripten::vecFromJSArray<float>(points));
+        }))
+        .function("setCompound", emscripten::optional_override([](World& world, int id, emscripten::val children) {
+            return world.setCompound(id, emscripten::vecFromJSArray<float>(children));
+        }))
+        .function("setTilemap", emscripten::optional_override([](World& world, int columns, int rows, float tileSize, float x, float y, emscripten::val tiles) {
+            return world.setTilemap(columns, rows, tileSize, x, y, emscripten::vecFromJSArray<int>(tiles));
+        }))
+        .function("setTerrainMaterial", &World::setTerrainMaterial)
+        .function("addMaterial", &World::addMaterial)
+        .function("setMaterial", &World::setMaterial)
+        .function("setObjectMaterial", &World::setObjectMaterial)
+        .function("setObjectCoefficients", &World::setObjectCoefficients)
+        .function("getMaterial", emscripten::optional_override([](World& world, int material) {
+            return world.materials.contains(material) ? world.materials.get(material) : Material();
+        }))
+        .function("internMaterial", emscripten::optional_override([](World& world, Material material) {
+            return world.materials.intern(material);
+        }))
         .function("getObject", &World::getObject, emscripten::allow_raw_pointers())
+        .function("getObjectByHandle", &World::getObjectByHandle, emscripten::allow_raw_pointers())
         .function("getObjectAtIndex", &World::getObjectAtIndex, emscripten::allow_raw_pointers())
         .function("getObjectCount", &World::getObjectCount)
+        .function("reserveObjects", &World::reserveObjects)
+        .function("getObjectCapacity", &World::getObjectCapacity)
+        .function("getBufferGeneration", &World::getBufferGeneration)
+        .function("getMemoryStats", &World::getMemoryStats)
+        .function("compact", &World::compact)
         .function("setTimeStep", &World::setTimeStep)
         .function("setGravity", &World::setGravity)
 
@@ -118,12 +185,19 @@ EMSCRIPTEN_BINDINGS(world) {
         // .function("getIds", &World::getIds, emscripten::allow_raw_pointers())
 
         .function("step", &World::step)
+        .function("advance", &World::advance)
+        .function("getInterpolationAlpha", &World::getInterpolationAlpha)
         .function("clear", &World::clear)
         .function("destroy", &World::destroy)
 
         .function("setHasPenetrationResolution", &World::setHasPenetrationResolution)
         .function("setHasRestitution", &World::setHasRestitution)
-        .function("setHasFriction", &World::setHasFriction);
+        .function("setHasFriction", &World::setHasFriction)
+        .function("setHasWarmStarting", &World::setHasWarmStarting)
+        .function("setVelocityIterations", &World::setVelocityIterations)
+        .function("setPositionIterations", &World::setPositionIterations)
+        .function("setThreadCount", &World::setThreadCount)
+        .function("setSubsteps", &World::setSubsteps);
 }
 
 #endif
\ No newline at end of file
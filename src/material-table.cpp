@@ -0,0 +1,101 @@
+#include <algorithm>
+#include "material-table.h"
+
+using namespace std;
+
+MaterialTable::MaterialTable() {
+    add(Material());  // DEFAULT_MATERIAL
+
+    Material terrain;
+    terrain.linearDamping = 0.0f;
+    terrain.angularDamping = 0.0f;
+    add(terrain);  // TERRAIN_MATERIAL
+}
+
+int MaterialTable::add(const Material& material) {
+    return _insert(material, MaterialState::KEPT);
+}
+
+// A freed id if there is one, or else a new one.
+int MaterialTable::_insert(const Material& material, MaterialState state) {
+    if (!_freeIds.empty()) {
+        int id = _freeIds.back();
+        _freeIds.pop_back();
+        _materials[id] = material;
+        _refs[id] = 0;
+        _state[id] = state;
+        _updatePairs(id);
+        return id;
+    }
+
+    if (_materials.size() >= MAX_MATERIALS) return -1;
+
+    int id = static_cast<int>(_materials.size());
+    _materials.push_back(material);
+    _refs.push_back(0);
+    _state.push_back(state);
+
+    if (id >= _stride) {
+        _stride = max(8, _stride * 2);
+        _pairs.assign(static_cast<size_t>(_stride) * _stride, MaterialPair{});
+        for (int i = 0; i < id; i++) _updatePairs(i);
+    }
+    _updatePairs(id);
+    return id;
+}
+
+bool MaterialTable::set(int id, const Material& material) {
+    if (!contains(id)) return false;
+
+    _materials[id] = material;
+    _updatePairs(id);
+    return true;
+}
+
+int MaterialTable::find(const Material& material) const {
+    for (size_t i = 0; i < _materials.size(); i++) {
+        if (i != TERRAIN_MATERIAL && _state[i] != MaterialState::FREE && _materials[i] == material) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int MaterialTable::intern(const Material& material) {
+    int id = find(material);
+    return id >= 0 ? id : _insert(material, MaterialState::INTERNED);
+}
+
+void MaterialTable::reclaim(int id) {
+    if (_state[id] != MaterialState::INTERNED || _refs[id] > 0) return;
+
+    _state[id] = MaterialState::FREE;
+    _freeIds.push_back(id);
+}
+
+size_t MaterialTable::bytesUsed() const {
+    size_t perMaterial = sizeof(Material) + sizeof(int) + sizeof(MaterialState);
+    return _materials.size() * perMaterial + _materials.size() * _materials.size() * sizeof(MaterialPair)
+        + _freeIds.size() * sizeof(int);
+}
+
+size_t MaterialTable::bytesReserved() const {
+    return _materials.capacity() * sizeof(Material) + _refs.capacity() * sizeof(int)
+        + _state.capacity() * sizeof(MaterialState) + _freeIds.capacity() * sizeof(int)
+        + _pairs.capacity() * sizeof(MaterialPair);
+}
+
+// Recompute the row and column of a material.
+void MaterialTable::_updatePairs(int id) {
+    const Material& a = _materials[id];
+    for (size_t i = 0; i < _materials.size(); i++) {
+        const Material& b = _materials[i];
+        MaterialPair combined{
+            max(a.restitution, b.restitution),
+            min(a.staticFriction, b.staticFriction),
+            min(a.kineticFriction, b.kineticFriction),
+        };
+        _pairs[id * _stride + i] = combined;
+        _pairs[i * _stride + id] = combined;
+    }
+}
@@ -0,0 +1,32 @@
+#include "object-desc.h"
+
+static void _read(const emscripten_val& options, const char* key, float& field) {
+    if (options.hasOwnProperty(key)) field = options[key].as<float>();
+}
+
+ObjectDesc ObjectDesc::fromVal(const emscripten_val& options) {
+    ObjectDesc desc;
+
+    if (options.hasOwnProperty("type")) desc.type = static_cast<ObjectType>(options["type"].as<int>());
+    if (options.hasOwnProperty("shape")) desc.shape = static_cast<ObjectShape>(options["shape"].as<int>());
+    if (options.hasOwnProperty("material")) desc.material = options["material"].as<int>();
+
+    _read(options, "x", desc.x);
+    _read(options, "y", desc.y);
+    _read(options, "r", desc.r);
+    _read(options, "vx", desc.vx);
+    _read(options, "vy", desc.vy);
+    _read(options, "rs", desc.rs);
+    _read(options, "mass", desc.mass);
+    _read(options, "gscale", desc.gravityScale);
+    _read(options, "restitution", desc.restitution);
+    _read(options, "sFriction", desc.staticFriction);
+    _read(options, "kFriction", desc.kineticFriction);
+    _read(options, "linearDamping", desc.linearDamping);
+    _read(options, "angularDamping", desc.angularDamping);
+    _read(options, "width", desc.width);
+    _read(options, "radius", desc.width);
+    _read(options, "height", desc.height);
+
+    return desc;
+}
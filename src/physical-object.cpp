@@ -18,55 +18,38 @@ static Vec2 _position;
 static Vec2 _velocity;   // Linear velocity of the object
 static float _inverseMass;
 
-PhysicalObject::PhysicalObject(World& world, int id, emscripten_val options) 
-    : world(world),
-        id(id),
-        bvhNode(nullptr),
-        type(options.hasOwnProperty("type") ? static_cast<ObjectType>(options["type"].as<int>()) : ObjectType::RIGID_BODY),
-        shape(options.hasOwnProperty("shape") ? static_cast<ObjectShape>(options["shape"].as<int>()) : ObjectShape::CIRCLE)
-{
-    world.liveIntData.push_back(id); // id.
-    world.liveIntData.push_back((int)shape); // shape.
-    world.liveIntData.push_back((int)type); // type.
-    world.liveIntData.push_back(0); // has collision bits.
-
-    world.liveFloatData.push_back(options.hasOwnProperty("x") ? options["x"].as<float>() : 0.0f); // x
-    world.liveFloatData.push_back(options.hasOwnProperty("y") ? options["y"].as<float>() : 0.0f); // y
-    world.liveFloatData.push_back(options.hasOwnProperty("r") ? options["r"].as<float>() : 0.0f); // rotation
-    world.liveFloatData.push_back(options.hasOwnProperty("vx") ? options["vx"].as<float>() : 0.0f); // vx
-    world.liveFloatData.push_back(options.hasOwnProperty("vy") ? options["vy"].as<float>() : 0.0f); // vy
-    world.liveFloatData.push_back(options.hasOwnProperty("rs") ? options["rs"].as<float>() : 0.0f); // rs
-    float mass = type != ObjectType::FIXED_OBJECT && options.hasOwnProperty("mass") ? options["mass"].as<float>() : 0.0f;
-    world.liveFloatData.push_back(mass); // mass
-    world.liveFloatData.push_back((mass > 0.0f) ? 1.0f / mass : 0.0f); // inverse mass
-    world.liveFloatData.push_back(options.hasOwnProperty("gscale") ? options["gscale"].as<float>() : 1.0f);
-    world.liveFloatData.push_back(options.hasOwnProperty("restitution") ? options["restitution"].as<float>() : 0.2f);
-    world.liveFloatData.push_back(options.hasOwnProperty("sFriction") ? options["sFriction"].as<float>() : 1.0f);
-    world.liveFloatData.push_back(options.hasOwnProperty("kFriction") ? options["kFriction"].as<float>() : 1.0f);
-    world.liveFloatData.push_back(options.hasOwnProperty("linearDamping") ? options["linearDamping"].as<float>() : 0.05f);
-    world.liveFloatData.push_back(options.hasOwnProperty("angularDamping") ? options["angularDamping"].as<float>() : 0.05f);
-    world.liveFloatData.push_back(
-        (
-            options.hasOwnProperty("radius") ? options["radius"].as<float>() : (
-                options.hasOwnProperty("width") ? options["width"].as<float>() : 0.0f)
-        )
-    ); // radius or width
-    world.liveFloatData.push_back(options.hasOwnProperty("height") ? options["height"].as<float>() : 0.0f); // height
-
-    world.liveFloatData.push_back(0.0f); // fx
-    world.liveFloatData.push_back(0.0f); // fy
-    world.liveFloatData.push_back(0.0f); // ix
-    world.liveFloatData.push_back(0.0f); // iy
-
-    world.liveFloatData.push_back(aabb.min.x); // x0
-    world.liveFloatData.push_back(aabb.min.y); // y0
-    world.liveFloatData.push_back(aabb.max.x); // x1
-    world.liveFloatData.push_back(aabb.max.y); // y1
-    
-    world.liveFloatData.push_back(0.0f); // nfx
-    world.liveFloatData.push_back(0.0f); // nfy
-    world.liveFloatData.push_back(0.0f); // nix
-    world.liveFloatData.push_back(0.0f); // niy
+void PhysicalObject::writeLiveData(int* ints, float* floats, int id, const ObjectDesc& desc, int material) {
+    fill(ints, ints + LIVE_INT_EPO, 0);
+    ints[LIVE_INT_ID] = id;
+    ints[LIVE_INT_SHAPE] = static_cast<int>(desc.shape);
+    ints[LIVE_INT_TYPE] = static_cast<int>(desc.type);
+    ints[LIVE_INT_HAS_COLLISION] = 0;
+    ints[LIVE_INT_SHAPE_DATA] = -1; // Polygon record, set by World::setPolygon.
+    ints[LIVE_INT_MATERIAL] = material;
+
+    // Forces, impulses and bounds start at zero.
+    float mass = desc.type != ObjectType::FIXED_OBJECT && desc.mass > 0.0f ? desc.mass : 0.0f;
+    fill(floats, floats + FDATA_EPO, 0.0f);
+    floats[FDATA_X] = desc.x;
+    floats[FDATA_Y] = desc.y;
+    floats[FDATA_R] = desc.r;
+    floats[FDATA_VX] = desc.vx;
+    floats[FDATA_VY] = desc.vy;
+    floats[FDATA_RS] = desc.rs;
+    floats[FDATA_M] = mass;
+    floats[FDATA_IM] = mass > 0.0f ? 1.0f / mass : 0.0f;
+    floats[FDATA_G_SCALE] = desc.gravityScale;
+    floats[FDATA_W] = desc.width;
+    floats[FDATA_H] = desc.height;
+    floats[FDATA_COS] = cos(desc.r);
+    floats[FDATA_SIN] = sin(desc.r);
+}
+
+PhysicalObject::PhysicalObject(World& world, int id, ObjectType type, ObjectShape shape)
+    : id(id), shape(shape), type(type), bvhNode(nullptr), world(world) {}
+
+PhysicalObject::~PhysicalObject() {
+    delete compound;
 }
 
 // Getters and Setters
@@ -76,7 +59,11 @@ float PhysicalObject::getY() const { return world.liveFloatData[worldIndex * FDA
 void PhysicalObject::setY(float y) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_Y] = y; }
 
 float PhysicalObject::getRotation() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_R]; }
-void PhysicalObject::setRotation(float r) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_R] = r; }
+void PhysicalObject::setRotation(float r) {
+    world.liveFloatData[worldIndex * FDATA_EPO + FDATA_R] = r;
+    world.liveFloatData[worldIndex * FDATA_EPO + FDATA_COS] = cos(r);
+    world.liveFloatData[worldIndex * FDATA_EPO + FDATA_SIN] = sin(r);
+}
 
 float PhysicalObject::getVelocityX() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_VX]; }
 void PhysicalObject::setVelocityX(float vx) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_VX] = vx; }
@@ -100,13 +87,13 @@ void PhysicalObject::setMass(float m) {
 float PhysicalObject::getInverseMass() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_IM]; }
 // void PhysicalObject::setInverseMass(float im) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_IM] = im; }
 
-float PhysicalObject::getDamping() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_DAMPING]; }
-void PhysicalObject::setDamping(float d) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_DAMPING] = d; }
-float PhysicalObject::getRotationalDamping() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_ANGULAR_DAMPING]; }
-void PhysicalObject::setRotationalDamping(float rd) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_ANGULAR_DAMPING] = rd; }
+float PhysicalObject::getDamping() const { return world.materials.get(getMaterial()).linearDamping; }
+bool PhysicalObject::setDamping(float d) { return _setMaterialValue(&Material::linearDamping, d); }
+float PhysicalObject::getRotationalDamping() const { return world.materials.get(getMaterial()).angularDamping; }
+bool PhysicalObject::setRotationalDamping(float rd) { return _setMaterialValue(&Material::angularDamping, rd); }
 
-float PhysicalObject::getRestitution() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_RESTITUTION]; }
-void PhysicalObject::setRestitution(float r) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_RESTITUTION] = r; }
+float PhysicalObject::getRestitution() const { return world.materials.get(getMaterial()).restitution; }
+bool PhysicalObject::setRestitution(float r) { return _setMaterialValue(&Material::restitution, r); }
 
 float PhysicalObject::getImpulseX() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_IX]; }
 void PhysicalObject::setImpulseX(float ix) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_IX] = ix; }
@@ -118,10 +105,33 @@ void PhysicalObject::setForceX(float fx) { world.liveFloatData[worldIndex * FDAT
 float PhysicalObject::getForceY() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_FY]; }
 void PhysicalObject::setForceY(float fy) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_FY] = fy; }
 
-float PhysicalObject::getStaticFriction() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_S_FRICTION]; }
-void PhysicalObject::setStaticFriction(float f) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_S_FRICTION] = f; }
-float PhysicalObject::getKineticFriction() const { return world.liveFloatData[worldIndex * FDATA_EPO + FDATA_K_FRICTION]; }
-void PhysicalObject::setKineticFriction(float f) { world.liveFloatData[worldIndex * FDATA_EPO + FDATA_K_FRICTION] = f; }
+float PhysicalObject::getStaticFriction() const { return world.materials.get(getMaterial()).staticFriction; }
+bool PhysicalObject::setStaticFriction(float f) { return _setMaterialValue(&Material::staticFriction, f); }
+float PhysicalObject::getKineticFriction() const { return world.materials.get(getMaterial()).kineticFriction; }
+bool PhysicalObject::setKineticFriction(float f) { return _setMaterialValue(&Material::kineticFriction, f); }
+
+int PhysicalObject::getMaterial() const { return world.liveIntData[worldIndex * LIVE_INT_EPO + LIVE_INT_MATERIAL]; }
+
+bool PhysicalObject::setMaterial(int material) {
+    if (!world.materials.contains(material)) return false;
+
+    // Acquired first, so switching to the same material doesn't drop it.
+    world.materials.acquire(material);
+    world.materials.release(getMaterial());
+    world.liveIntData[worldIndex * LIVE_INT_EPO + LIVE_INT_MATERIAL] = material;
+    return true;
+}
+
+bool PhysicalObject::setCoefficients(const Material& coefficients) {
+    int id = world.materials.intern(coefficients);
+    return id >= 0 && setMaterial(id);
+}
+
+bool PhysicalObject::_setMaterialValue(float Material::* field, float value) {
+    Material material = world.materials.get(getMaterial());
+    material.*field = value;
+    return setCoefficients(material);
+}
 
 Vec2 PhysicalObject::getPosition() const { return Vec2(getX(), getY()); }
 void PhysicalObject::setPosition(Vec2 p) { setX(p.x); setY(p.y); }
@@ -144,19 +154,6 @@ bool PhysicalObject::recomputeAabb(bool disablePadding){
     float py = world.liveFloatData[worldIndex * FDATA_EPO + FDATA_Y];
     float w = world.liveFloatData[worldIndex * FDATA_EPO + FDATA_W];
     float h = world.liveFloatData[worldIndex * FDATA_EPO + FDATA_H];
-    float r = world.liveFloatData[worldIndex * FDATA_EPO + FDATA_R];
-    // float r = 1.0f;
-    float cr;
-    float sr;
-
-    float tl_x;
-    float tl_y;
-    float tr_x;
-    float tr_y;
-    float br_x;
-    float br_y;
-    float bl_x;
-    float bl_y;
 
     // Calculate the AABB for the object based on its shape.
     switch (shape) {
@@ -181,37 +178,50 @@ bool PhysicalObject::recomputeAabb(bool disablePadding){
             break;
         case ObjectShape::BOX:
         case ObjectShape::ELLIPSE:
-            cr = cos(r);
-            sr = sin(r);
-            tl_x = (-w/2) * cr - (-h/2) * sr + px; 
-            tl_y = (-w/2) * sr + (-h/2) * cr + py;
-            tr_x = ( w/2) * cr - (-h/2) * sr + px; 
-            tr_y = ( w/2) * sr + (-h/2) * cr + py;
-            br_x = ( w/2) * cr - ( h/2) * sr + px; 
-            br_y = ( w/2) * sr + ( h/2) * cr + py;
-            bl_x = (-w/2) * cr - ( h/2) * sr + px;
-            bl_y = (-w/2) * sr + ( h/2) * cr + py;
-
-            newX1 = std::min({tl_x, tr_x, br_x, bl_x});
-            newY1 = std::min({tl_y, tr_y, br_y, bl_y});
-            newX2 = std::max({tl_x, tr_x, br_x, bl_x});
-            newY2 = std::max({tl_y, tr_y, br_y, bl_y});
+        case ObjectShape::POLYGON: {
+            // Corners were computed with the shape cache this step.
+            const ShapeCache& cache = world.shapeCache[worldIndex];
+            if(cache.vertexCount == 0){
+                newX1 = newX2 = px;
+                newY1 = newY2 = py;
+                break;
+            }
+
+            newX1 = newX2 = cache.vertices[0].x;
+            newY1 = newY2 = cache.vertices[0].y;
+            for (int i = 1; i < cache.vertexCount; i++) {
+                newX1 = std::min(newX1, cache.vertices[i].x);
+                newY1 = std::min(newY1, cache.vertices[i].y);
+                newX2 = std::max(newX2, cache.vertices[i].x);
+                newY2 = std::max(newY2, cache.vertices[i].y);
+            }
 
             break;
-        case ObjectShape::CAPSULE:
-            // TODO: this must handle rotations.
-            newX1 = px - w / 2;
-            newY1 = py - h / 2;
-            newX2 = px + w / 2;
-            newY2 = py + h / 2;
+        }
+        case ObjectShape::COMPOUND:
+            // Child geometry was transformed with the shape cache this step.
+            if(compound){
+                newX1 = compound->bounds.min.x;
+                newY1 = compound->bounds.min.y;
+                newX2 = compound->bounds.max.x;
+                newY2 = compound->bounds.max.y;
+            }
+            else{
+                newX1 = newX2 = px;
+                newY1 = newY2 = py;
+            }
             break;
-        case ObjectShape::POLYGON:
-            // TODO.
-            newX1 = px;
-            newY1 = px;
-            newX2 = py;
-            newY2 = py;
+        case ObjectShape::CAPSULE: {
+            // The core segment was computed with the shape cache this step.
+            const Vec2* segment = world.shapeCache[worldIndex].vertices;
+            float radius = h / 2;
+
+            newX1 = std::min(segment[0].x, segment[1].x) - radius;
+            newY1 = std::min(segment[0].y, segment[1].y) - radius;
+            newX2 = std::max(segment[0].x, segment[1].x) + radius;
+            newY2 = std::max(segment[0].y, segment[1].y) + radius;
             break;
+        }
     }
 
     if (newX1 < aabb.min.x || newY1 < aabb.min.y || newX2 > aabb.max.x || newY2 > aabb.max.y) {
@@ -296,8 +306,36 @@ void PhysicalObject::applyImpulse(float x, float y, float cpX, float cpY){
     //     delete this;
     // }
 
+// Rotate the unit complex number (c, s) by angle.
+// Small angles (any reasonable step) use the Taylor series instead of cos/sin. The result is
+// renormalized so rounding errors don't accumulate.
+static void _integrateRotation(float& c, float& s, float angle) {
+    float qc;
+    float qs;
+    if(fabs(angle) < 0.25f){
+        float a2 = angle * angle;
+        qc = 1.0f - a2 / 2.0f * (1.0f - a2 / 12.0f * (1.0f - a2 / 30.0f));
+        qs = angle * (1.0f - a2 / 6.0f * (1.0f - a2 / 20.0f * (1.0f - a2 / 42.0f)));
+    }
+    else{
+        qc = cos(angle);
+        qs = sin(angle);
+    }
+
+    float nc = c * qc - s * qs;
+    float ns = s * qc + c * qs;
+    float invLength = 1.0f / sqrt(nc * nc + ns * ns);
+    c = nc * invLength;
+    s = ns * invLength;
+}
+
     // Step function to update position and rotation
 bool PhysicalObject::stepMovement(float dt) {
+    integrateVelocity(dt);
+    return integratePosition(dt);
+}
+
+void PhysicalObject::integrateVelocity(float dt) {
     int index = worldIndex * FDATA_EPO;
     _inverseMass = world.liveFloatData[index + FDATA_IM];
 
@@ -305,11 +343,6 @@ bool PhysicalObject::stepMovement(float dt) {
     world.liveFloatData[index + FDATA_FX] = 0;
     world.liveFloatData[index + FDATA_FY] = 0;
 
-    // Cache the last position.
-    // Probably redundant now.
-    _position.x = world.liveFloatData[index + FDATA_X];
-    _position.y = world.liveFloatData[index + FDATA_Y];
-
     // Apply the acculumated impulse.
     applyImpulse(world.liveFloatData[index + FDATA_NIX], world.liveFloatData[index + FDATA_NIY], 0.0f, 0.0f);
 
@@ -346,6 +379,33 @@ bool PhysicalObject::stepMovement(float dt) {
     _dv = _acceleration * dt * 0.5f;
     _velocity = _velocity + _dv;
 
+    world.liveFloatData[index + FDATA_VX] = _velocity.x;
+    world.liveFloatData[index + FDATA_VY] = _velocity.y;
+}
+
+void PhysicalObject::syncRotation() {
+    float* data = &world.liveFloatData[worldIndex * FDATA_EPO];
+    if(shape == ObjectShape::AABB) data[FDATA_R] = 0.0f;
+    data[FDATA_COS] = cos(data[FDATA_R]);
+    data[FDATA_SIN] = sin(data[FDATA_R]);
+}
+
+bool PhysicalObject::wasMovedExternally() const {
+    int index = worldIndex * FDATA_EPO;
+    return world.liveFloatData[index + FDATA_X] != lastX
+        || world.liveFloatData[index + FDATA_Y] != lastY
+        || world.liveFloatData[index + FDATA_R] != lastR;
+}
+
+bool PhysicalObject::integratePosition(float dt) {
+    int index = worldIndex * FDATA_EPO;
+
+    // Velocities may have been changed by a solver since integrateVelocity.
+    _position.x = world.liveFloatData[index + FDATA_X];
+    _position.y = world.liveFloatData[index + FDATA_Y];
+    _velocity.x = world.liveFloatData[index + FDATA_VX];
+    _velocity.y = world.liveFloatData[index + FDATA_VY];
+
     // ix and iy are for visual debugging.
     // We can decay them here.
 
@@ -361,7 +421,22 @@ bool PhysicalObject::stepMovement(float dt) {
     float rs2 = world.liveFloatData[index + FDATA_RS];
 
     // Update rotation based on rotational speed and time step.
-    world.liveFloatData[index + FDATA_R] += (rs1 + rs2) * dt * 0.5f;
+    float* data = &world.liveFloatData[index];
+    if(shape == ObjectShape::AABB){
+        data[FDATA_R] = 0.0f;
+        data[FDATA_COS] = 1.0f;
+        data[FDATA_SIN] = 0.0f;
+    }
+    else{
+        // The angle was set from outside since the last step.
+        if(data[FDATA_R] != lastR) syncRotation();
+
+        float angle = (rs1 + rs2) * dt * 0.5f;
+        if(angle != 0.0f){
+            data[FDATA_R] += angle;
+            _integrateRotation(data[FDATA_COS], data[FDATA_SIN], angle);
+        }
+    }
 
     // TODO: I don't like how the full damping takes effect per frame. It should be per second.
     // This requires us to basically hard code frame rates.
@@ -374,8 +449,6 @@ bool PhysicalObject::stepMovement(float dt) {
     // Reassign the values to the live data.
     world.liveFloatData[index + FDATA_X] = _position.x;
     world.liveFloatData[index + FDATA_Y] = _position.y;
-    world.liveFloatData[index + FDATA_VX] = _velocity.x;
-    world.liveFloatData[index + FDATA_VY] = _velocity.y;
 
     bool moved = world.liveFloatData[index + FDATA_X] != lastX 
         || world.liveFloatData[index + FDATA_Y] != lastY 
@@ -385,9 +458,5 @@ bool PhysicalObject::stepMovement(float dt) {
     lastY = world.liveFloatData[index + FDATA_Y];
     lastR = world.liveFloatData[index + FDATA_R];
 
-    if(shape == ObjectShape::AABB){
-        setRotation(0.0f);
-    }
-
     return moved;
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "shape-cache.h"
+
+using namespace std;
+
+void updateShapeCache(const vector<int>& intData, const vector<float>& floatData, int index, ShapeCache& cache,
+                      const vector<float>& polygons) {
+    const float* data = &floatData[index * FDATA_EPO];
+    int shape = intData[index * LIVE_INT_EPO + LIVE_INT_SHAPE];
+
+    cache.axisX = shape == static_cast<int>(ObjectShape::AABB) ? Vec2(1.0f, 0.0f) : Vec2(data[FDATA_COS], data[FDATA_SIN]);
+    cache.axisY = Vec2(-cache.axisX.y, cache.axisX.x);
+
+    switch(shape){
+        case static_cast<int>(ObjectShape::AABB):
+        case static_cast<int>(ObjectShape::BOX):
+        case static_cast<int>(ObjectShape::ELLIPSE): {
+            Vec2 center(data[FDATA_X], data[FDATA_Y]);
+            Vec2 halfX = cache.axisX * (data[FDATA_W] / 2.0f);
+            Vec2 halfY = cache.axisY * (data[FDATA_H] / 2.0f);
+
+            cache.vertexCount = 4;
+            cache.vertices[0] = center - halfX - halfY;
+            cache.vertices[1] = center + halfX - halfY;
+            cache.vertices[2] = center + halfX + halfY;
+            cache.vertices[3] = center - halfX + halfY;
+
+            cache.normals[0] = -cache.axisY;
+            cache.normals[1] = cache.axisX;
+            cache.normals[2] = cache.axisY;
+            cache.normals[3] = -cache.axisX;
+            break;
+        }
+        case static_cast<int>(ObjectShape::CAPSULE): {
+            // The core segment along the local x axis. The rounding radius is half the height.
+            Vec2 center(data[FDATA_X], data[FDATA_Y]);
+            Vec2 half = cache.axisX * max(0.0f, (data[FDATA_W] - data[FDATA_H]) / 2.0f);
+
+            cache.vertexCount = 2;
+            cache.vertices[0] = center - half;
+            cache.vertices[1] = center + half;
+            cache.normals[0] = -cache.axisY;
+            cache.normals[1] = cache.axisY;
+            break;
+        }
+        case static_cast<int>(ObjectShape::POLYGON): {
+            int offset = intData[index * LIVE_INT_EPO + LIVE_INT_SHAPE_DATA];
+            if(offset < 0 || offset + POLYGON_RECORD_SIZE > static_cast<int>(polygons.size())){
+                cache.vertexCount = 0;
+                break;
+            }
+
+            Vec2 center(data[FDATA_X], data[FDATA_Y]);
+            const float* record = &polygons[offset];
+            int count = static_cast<int>(record[0]);
+            const float* vertices = record + 1;
+            const float* normals = record + 1 + MAX_POLYGON_VERTICES * 2;
+
+            cache.vertexCount = count;
+            for (int i = 0; i < count; i++) {
+                cache.vertices[i] = center + cache.axisX * vertices[i * 2] + cache.axisY * vertices[i * 2 + 1];
+                cache.normals[i] = cache.axisX * normals[i * 2] + cache.axisY * normals[i * 2 + 1];
+            }
+            break;
+        }
+        default:
+            cache.vertexCount = 0;
+            break;
+    }
+}
+
+void updateShapeCaches(const vector<int>& intData, const vector<float>& floatData, vector<ShapeCache>& caches,
+                       const vector<float>& polygons) {
+    int count = static_cast<int>(floatData.size() / FDATA_EPO);
+    caches.resize(count);
+    for (int i = 0; i < count; i++) {
+        updateShapeCache(intData, floatData, i, caches[i], polygons);
+    }
+}
+
+float writePolygonRecord(vector<float>& polygons, int offset, const vector<float>& points) {
+    int count = static_cast<int>(points.size() / 2);
+    if(count < 3 || count > MAX_POLYGON_VERTICES || points.size() % 2 != 0) return -1.0f;
+
+    Vec2 vertices[MAX_POLYGON_VERTICES];
+    for (int i = 0; i < count; i++) vertices[i] = Vec2(points[i * 2], points[i * 2 + 1]);
+
+    // Shoelace area. Clockwise input is reversed.
+    float area = 0.0f;
+    for (int i = 0; i < count; i++) area += vertices[i].cross(vertices[(i + 1) % count]);
+    if(area == 0.0f) return -1.0f;
+    if(area < 0.0f) reverse(vertices, vertices + count);
+
+    // Every corner has to turn the same way.
+    for (int i = 0; i < count; i++) {
+        Vec2 e1 = vertices[(i + 1) % count] - vertices[i];
+        Vec2 e2 = vertices[(i + 2) % count] - vertices[(i + 1) % count];
+        if(e1.cross(e2) <= 0.0f) return -1.0f;
+    }
+
+    if(offset + POLYGON_RECORD_SIZE > static_cast<int>(polygons.size())) polygons.resize(offset + POLYGON_RECORD_SIZE);
+    float* record = &polygons[offset];
+    float* outVertices = record + 1;
+    float* outNormals = record + 1 + MAX_POLYGON_VERTICES * 2;
+
+    record[0] = static_cast<float>(count);
+    float radius = 0.0f;
+    for (int i = 0; i < count; i++) {
+        Vec2 edge = vertices[(i + 1) % count] - vertices[i];
+        Vec2 normal = Vec2(edge.y, -edge.x).normalize();
+
+        outVertices[i * 2] = vertices[i].x;
+        outVertices[i * 2 + 1] = vertices[i].y;
+        outNormals[i * 2] = normal.x;
+        outNormals[i * 2 + 1] = normal.y;
+        radius = max(radius, vertices[i].magnitude());
+    }
+
+    return radius;
+}
@@ -0,0 +1,64 @@
+#include "tilemap.h"
+
+using namespace std;
+
+bool Tilemap::set(int columns, int rows, float tileSize, const Vec2& origin, const vector<int>& tiles) {
+    if (columns < 0 || rows < 0 || tileSize <= 0.0f) return false;
+    if (tiles.size() != static_cast<size_t>(columns) * static_cast<size_t>(rows)) return false;
+
+    this->columns = columns;
+    this->rows = rows;
+    this->tileSize = tileSize;
+    this->origin = origin;
+
+    solid.resize(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++) solid[i] = tiles[i] != 0;
+
+    cellRects.assign(tiles.size(), -1);
+    rects.clear();
+
+    // Greedy merge: take the longest run of unclaimed solid tiles in a row, then grow it down for
+    // as long as the rows below have the same run.
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (!solid[row * columns + column] || cellRects[row * columns + column] >= 0) continue;
+
+            int width = 1;
+            while (column + width < columns && solid[row * columns + column + width]
+                   && cellRects[row * columns + column + width] < 0) width++;
+
+            int height = 1;
+            while (row + height < rows) {
+                const int* below = &cellRects[(row + height) * columns + column];
+                const unsigned char* belowSolid = &solid[(row + height) * columns + column];
+                bool same = true;
+                for (int i = 0; i < width && same; i++) same = belowSolid[i] && below[i] < 0;
+
+                // The run below must end where this one does, or it gets split into slivers.
+                if (same && column + width < columns && belowSolid[width] && below[width] < 0) same = false;
+                if (same && column > 0 && belowSolid[-1] && below[-1] < 0) same = false;
+                if (!same) break;
+                height++;
+            }
+
+            int index = static_cast<int>(rects.size());
+            Vec2 min = origin + Vec2(column * tileSize, row * tileSize);
+            Vec2 max = min + Vec2(width * tileSize, height * tileSize);
+            rects.push_back(TileRect{column, row, width, height, Aabb(min, max)});
+
+            for (int y = row; y < row + height; y++) {
+                for (int x = column; x < column + width; x++) cellRects[y * columns + x] = index;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Tilemap::clear() {
+    columns = 0;
+    rows = 0;
+    solid.clear();
+    cellRects.clear();
+    rects.clear();
+}
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "worker-pool.h"
+
+using namespace std;
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define GB2D_NO_THREADS
+#endif
+
+WorkerPool::WorkerPool() {}
+
+WorkerPool::~WorkerPool() {
+    _stopWorkers();
+}
+
+void WorkerPool::setThreadCount(int count) {
+#ifdef GB2D_NO_THREADS
+    (void)count;
+#else
+    count = max(1, count);
+    if (count == getThreadCount()) return;
+
+    _stopWorkers();
+
+    _stopping = false;
+    for (int i = 0; i < count - 1; i++) {
+        _workers.emplace_back(&WorkerPool::_workerLoop, this, i, _generation);
+    }
+#endif
+}
+
+int WorkerPool::getThreadCount() const {
+    return static_cast<int>(_workers.size()) + 1;
+}
+
+void WorkerPool::parallelFor(int count, const function<void(int, int)>& fn) {
+    if (count <= 0) return;
+
+    if (_workers.empty() || count < minParallelCount) {
+        fn(0, count);
+        return;
+    }
+
+    int threadCount = getThreadCount();
+    int chunkSize = (count + threadCount - 1) / threadCount;
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _task = &fn;
+        _taskCount = count;
+        _chunkSize = chunkSize;
+        _pending = static_cast<int>(_workers.size());
+        _generation++;
+    }
+    _workAvailable.notify_all();
+
+    // The calling thread takes the first chunk.
+    fn(0, min(chunkSize, count));
+
+    unique_lock<mutex> lock(_mutex);
+    _workDone.wait(lock, [this]{ return _pending == 0; });
+    _task = nullptr;
+}
+
+void WorkerPool::_workerLoop(int workerIndex, int seenGeneration) {
+    while (true) {
+        unique_lock<mutex> lock(_mutex);
+        _workAvailable.wait(lock, [&]{ return _stopping || _generation != seenGeneration; });
+        if (_stopping) return;
+
+        seenGeneration = _generation;
+        const function<void(int, int)>* task = _task;
+        int begin = (workerIndex + 1) * _chunkSize;
+        int end = min(begin + _chunkSize, _taskCount);
+        lock.unlock();
+
+        if (begin < end) (*task)(begin, end);
+
+        lock.lock();
+        if (--_pending == 0) _workDone.notify_one();
+    }
+}
+
+void WorkerPool::_stopWorkers() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+
+    for (auto& worker : _workers) worker.join();
+    _workers.clear();
+}
@@ -1,4 +1,8 @@
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
 #include <iostream>
 #include "world.h"
 // #include "physical-object.h"
@@ -7,112 +11,479 @@
 using namespace std;
 
 World::World():
-    collisionSolver(liveIntData, liveFloatData){
-    // TODO: if we add more than 10k items, there should be some kind of event to warn the client.
-    // Currently, the engine crashes with that many items. But with optimizations it's possible to exceed that.
+    collisionSolver(liveIntData, liveFloatData, shapeCache),
+    impulseSolver(liveIntData, liveFloatData){
+    bvh.frameArena = &frameArena;
+    collisionSolver.frameArena = &frameArena;
+    impulseSolver.frameArena = &frameArena;
+    impulseSolver.materials = &materials;
+
     setTimeStep(1.0f / 60.0f);
-    int size = 10000;
-    liveFloatData.reserve(size * FDATA_EPO);
-    liveIntData.reserve(size * LIVE_INT_EPO);
+    reserveObjects(INITIAL_OBJECT_CAPACITY);
+    _clearEvents();
 
     // collisionSolver = CollisionSolver(liveIntData, liveFloatData);
 }
 
 World::~World() {
     clear();
+    _releasePools();
 }
 
-int World::makeObject(int id, emscripten_val options){
-    auto object = new PhysicalObject(*this, id, options);
-
-    object->worldIndex = objectsList.size();
-
-    objectsMap[id] = object;
-    objectsList.push_back(object);
+uint32_t World::makeObject(int id, emscripten_val options){
+    return makeObject(id, ObjectDesc::fromVal(options));
+}
 
-    object->recomputeAabb(true);
+uint32_t World::makeObject(int id, const ObjectDesc& desc){
+    int material = desc.material;
+    if (material < 0) {
+        Material coefficients{desc.restitution, desc.staticFriction, desc.kineticFriction, desc.linearDamping, desc.angularDamping};
+        material = materials.intern(coefficients);
+    }
+    if (!materials.contains(material)) return INVALID_HANDLE;
+    materials.acquire(material);
+
+    int index = _claimRecord();
+    PhysicalObject::writeLiveData(&liveIntData[index * LIVE_INT_EPO], &liveFloatData[index * FDATA_EPO], id, desc, material);
+
+    auto object = _acquireObject(id, desc.type, desc.shape);
+    if (!_registerObject(object, index)) {
+        // Out of handles. The record becomes a hole, like a removed object's.
+        _releaseObject(object);
+        pendingRemovals.push_back(index);
+        materials.release(material);
+        return INVALID_HANDLE;
+    }
 
     auto * bvhNode = bvh.insert(object->aabb, object);
     object->bvhNode = bvhNode;
 
     // cout << object->getRadius() << endl;
 
-    return object->worldIndex;
+    return object->handle;
 }
 
-int World::removeObject(int id) {
+// A record for a new object: the hole of an object removed since the last step if there is one,
+// so spawning and despawning don't move any records, or else a new record at the end.
+int World::_claimRecord() {
+    if (!pendingRemovals.empty()) {
+        int index = pendingRemovals.back();
+        pendingRemovals.pop_back();
+        return index;
+    }
+
+    size_t count = objectsList.size() + 1;
+    if (count > objectCapacity) reserveObjects(static_cast<int>(objectCapacity * 2));
+    _resizeRecords(count);
+    return static_cast<int>(count - 1);
+}
 
-    // cout << "Removing object with id: " << id << endl;
+// Resize every per-object buffer to hold count records.
+void World::_resizeRecords(size_t count) {
+    objectsList.resize(count, nullptr);
+    liveIntData.resize(count * LIVE_INT_EPO);
+    liveFloatData.resize(count * FDATA_EPO);
+    previousTransforms.resize(count * RENDER_EPO);
+    renderData.resize(count * RENDER_EPO);
+    shapeCache.resize(count);
+    movedInStep.resize(count);
+}
 
-    auto it = objectsMap.find(id);
+// Removed objects are kept for reuse, so churn doesn't allocate. A reused object is constructed
+// again in place, which resets every field.
+PhysicalObject* World::_acquireObject(int id, ObjectType type, ObjectShape shape) {
+    if (objectPool.empty()) return new PhysicalObject(*this, id, type, shape);
 
-    if (it != objectsMap.end()) {
-        auto object = it->second;
+    void* memory = objectPool.back();
+    objectPool.pop_back();
+    return new (memory) PhysicalObject(*this, id, type, shape);
+}
+
+void World::_releaseObject(PhysicalObject* object) {
+    object->~PhysicalObject();
+    objectPool.push_back(object);
+}
 
-        // Remove the object from the BVH
-        // cout << "Remove from BVH???" << endl;
-        if (object->bvhNode) {
-            // cout << "Removing from BVH" << endl;
-            // TODO: ensure that this frees up the memory used by the node.
-            bvh.remove(object->bvhNode);
-            object->bvhNode = nullptr;
+void World::_releasePools() {
+    for (PhysicalObject* object : objectPool) ::operator delete(object);
+    objectPool.clear();
+    idNodePool.clear();
+    bvh.releasePool();
+}
+
+// Move a buffer into an allocation of exactly capacity elements, which may be smaller than the
+// one it had. reserve alone never shrinks.
+template<typename T>
+static void _reallocate(vector<T>& buffer, size_t capacity) {
+    vector<T> fresh;
+    fresh.reserve(max(capacity, buffer.size()));
+    fresh.insert(fresh.end(), make_move_iterator(buffer.begin()), make_move_iterator(buffer.end()));
+    buffer.swap(fresh);
+}
+
+// Give an object whose live data record at index has been written its handle and the rest of its
+// per-object records. Everything but the BVH. Returns false, having changed nothing, if the slot
+// map is out of handles.
+bool World::_registerObject(PhysicalObject* object, int index) {
+    uint32_t handle = objects.insert(object);
+    if (handle == INVALID_HANDLE) return false;
+
+    object->worldIndex = index;
+    object->handle = handle;
+
+    uint32_t slot = SlotMap<PhysicalObject*>::slotOf(object->handle);
+    if (slot >= slotIndices.size()) {
+        // Retired slots are never reused, so there can be more slots than the capacity, and a new
+        // one may not fit. JS views slotIndices, so moving it is a buffer change like any other.
+        if (slot >= slotIndices.capacity()) {
+            _reallocate(slotIndices, max(static_cast<size_t>(slot) + 1, slotIndices.capacity() * 2));
+            bufferGeneration++;
         }
+        slotIndices.resize(slot + 1, -1);
+    }
+    slotIndices[slot] = index;
+
+    // Map entries of removed objects are reused too.
+    if (idNodePool.empty()) handlesById[object->id] = object->handle;
+    else {
+        auto node = move(idNodePool.back());
+        idNodePool.pop_back();
+        node.key() = object->id;
+        node.mapped() = object->handle;
+        auto result = handlesById.insert(move(node));
+        if (!result.inserted) {
+            result.position->second = object->handle;
+            idNodePool.push_back(move(result.node));
+        }
+    }
+    objectsList[index] = object;
 
-        // Get the index of the object to remove
-        int index = object->worldIndex;
-
-        // Clear the object's reference to the world
-        // object->world = nullptr;
-        // TODO: shouldn't I delete the object reference too?
-        // This can be done by calling object->destroy(true);
-        object->worldIndex = -1;
-
-        // Remove the object from the list if it has a valid index
-        if (index != -1 && index < objectsList.size()) {
-            // Swap the object to be removed with the last object in the list
-            iter_swap(objectsList.begin() + index, objectsList.end() - 1);
-
-            for(int i = 0; i < LIVE_INT_EPO; i++){
-                iter_swap(
-                    liveIntData.begin() + index * LIVE_INT_EPO + i, 
-                    liveIntData.begin() + (liveIntData.size() / LIVE_INT_EPO - 1) * LIVE_INT_EPO + i
-                );
-            }
+    _updateShape(object);
+    movedInStep[index] = 1;
+    object->recomputeAabb(true);
 
-            for(int i = 0; i < FDATA_EPO; i++){
-                iter_swap(
-                    liveFloatData.begin() + index * FDATA_EPO + i, 
-                    liveFloatData.begin() + (liveFloatData.size() / FDATA_EPO - 1) * FDATA_EPO + i
-                );
-            }
-            // Update the worldIndex of the swapped object
-            objectsList[index]->worldIndex = index;
-
-            // Remove the last element (which is the object we want to remove)
-            objectsList.pop_back();
-            // ids.pop_back();
-            liveFloatData.resize(objectsList.size() * FDATA_EPO);
-            liveIntData.resize(objectsList.size() * LIVE_INT_EPO);
+    // Nothing to interpolate from yet.
+    for(int i : {FDATA_X, FDATA_Y, FDATA_R}){
+        previousTransforms[index * RENDER_EPO + i] = liveFloatData[index * FDATA_EPO + i];
+        renderData[index * RENDER_EPO + i] = liveFloatData[index * FDATA_EPO + i];
+    }
+    return true;
+}
+
+void World::setStagingCapacity(int count) {
+    if (count < 0) return;
+
+    stagingFloatData.assign(static_cast<size_t>(count) * FDATA_EPO, 0.0f);
+    stagingIntData.assign(static_cast<size_t>(count) * LIVE_INT_EPO, 0);
+    stagingHandles.assign(count, INVALID_HANDLE);
+}
+
+int World::getStagingCapacity() const {
+    return static_cast<int>(stagingHandles.size());
+}
+
+int World::makeObjects(int count) {
+    if (count <= 0 || static_cast<size_t>(count) > stagingHandles.size()) return 0;
+    // Checked up front so registering can't fail part way through. Materials interned for the
+    // batch that it doesn't get to use are dropped.
+    bool valid = static_cast<size_t>(count) <= objects.available();
+    for (int i = 0; i < count; i++) {
+        valid = valid && materials.contains(stagingIntData[i * LIVE_INT_EPO + LIVE_INT_MATERIAL]);
+    }
+    if (!valid) {
+        for (int i = 0; i < count; i++) {
+            int material = stagingIntData[i * LIVE_INT_EPO + LIVE_INT_MATERIAL];
+            if (materials.contains(material)) materials.reclaim(material);
         }
+        return 0;
+    }
 
-        // Remove the object from the map
-        objectsMap.erase(it);
+    size_t first = objectsList.size();
+    if (first + count > objectCapacity) reserveObjects(static_cast<int>(max(objectCapacity * 2, first + count)));
 
-        delete object;
+    _resizeRecords(first + count);
+    copy_n(stagingIntData.begin(), count * LIVE_INT_EPO, liveIntData.begin() + first * LIVE_INT_EPO);
+    copy_n(stagingFloatData.begin(), count * FDATA_EPO, liveFloatData.begin() + first * FDATA_EPO);
 
-        return index;
+    vector<Aabb> aabbs(count);
+    vector<void*> userData(count);
+
+    for (int i = 0; i < count; i++) {
+        int* ints = &liveIntData[(first + i) * LIVE_INT_EPO];
+        float* floats = &liveFloatData[(first + i) * FDATA_EPO];
+
+        // Only the inputs are taken from the staging data. Everything derived from them, and
+        // everything the engine owns, starts the same as it does in makeObject.
+        ObjectType type = static_cast<ObjectType>(ints[LIVE_INT_TYPE]);
+        ints[LIVE_INT_HAS_COLLISION] = 0;
+        ints[LIVE_INT_SHAPE_DATA] = -1;
+        materials.acquire(ints[LIVE_INT_MATERIAL]);
+
+        if (type == ObjectType::FIXED_OBJECT || floats[FDATA_M] < 0.0f) floats[FDATA_M] = 0.0f;
+        floats[FDATA_IM] = floats[FDATA_M] > 0.0f ? 1.0f / floats[FDATA_M] : 0.0f;
+        fill(floats + FDATA_FX, floats + FDATA_AX1, 0.0f);
+        fill(floats + FDATA_NFX, floats + FDATA_COS, 0.0f);
+        floats[FDATA_COS] = cos(floats[FDATA_R]);
+        floats[FDATA_SIN] = sin(floats[FDATA_R]);
+
+        auto object = _acquireObject(ints[LIVE_INT_ID], type, static_cast<ObjectShape>(ints[LIVE_INT_SHAPE]));
+        _registerObject(object, static_cast<int>(first + i));
+
+        stagingHandles[i] = object->handle;
+        aabbs[i] = object->aabb;
+        userData[i] = object;
     }
-    else return -1;
+
+    vector<TreeNode*> leaves;
+    bvh.insertBatch(aabbs, userData, leaves);
+    for (int i = 0; i < count; i++) objectsList[first + i]->bvhNode = leaves[i];
+
+    return count;
+}
+
+bool World::removeObject(int id) {
+    auto it = handlesById.find(id);
+    if (it == handlesById.end()) return false;
+
+    return removeObjectByHandle(it->second);
+}
+
+bool World::removeObjectByHandle(uint32_t handle) {
+    PhysicalObject* object = getObjectByHandle(handle);
+    if (!object) return false;
+
+    // Remove the object from the BVH
+    if (object->bvhNode) {
+        // The nodes go back to the BVH's pool.
+        bvh.remove(object->bvhNode);
+        object->bvhNode = nullptr;
+    }
+
+    int index = object->worldIndex;
+
+    int& polygonRecord = liveIntData[index * LIVE_INT_EPO + LIVE_INT_SHAPE_DATA];
+    if (polygonRecord >= 0) freePolygonRecords.push_back(polygonRecord);
+    polygonRecord = -1;
+    materials.release(liveIntData[index * LIVE_INT_EPO + LIVE_INT_MATERIAL]);
+
+    // The record stays in place as a hole until the next step.
+    objectsList[index] = nullptr;
+    pendingRemovals.push_back(index);
+    slotIndices[SlotMap<PhysicalObject*>::slotOf(handle)] = -1;
+
+    auto it = handlesById.find(object->id);
+    if (it != handlesById.end() && it->second == handle) idNodePool.push_back(handlesById.extract(it));
+    objects.remove(handle);
+
+    _releaseObject(object);
+
+    return true;
+}
+
+void World::reserveObjects(int count) {
+    if (count <= 0 || static_cast<size_t>(count) <= objectCapacity) return;
+    _setObjectCapacity(count);
+}
+
+// Reallocate every per-object buffer for capacity objects. Holes must have been flushed if this
+// shrinks.
+void World::_setObjectCapacity(size_t capacity) {
+    objectCapacity = capacity;
+    _reallocate(liveFloatData, objectCapacity * FDATA_EPO);
+    _reallocate(liveIntData, objectCapacity * LIVE_INT_EPO);
+    _reallocate(previousTransforms, objectCapacity * RENDER_EPO);
+    _reallocate(renderData, objectCapacity * RENDER_EPO);
+    _reallocate(shapeCache, objectCapacity);
+    _reallocate(movedInStep, objectCapacity);
+    _reallocate(objectsList, objectCapacity);
+    // Room for a slot per object. Slots are never dropped and retired ones never reused, so there
+    // may be more slots than that: _registerObject grows it again when a new slot doesn't fit.
+    _reallocate(slotIndices, max(objectCapacity, objects.slotCount()));
+    objects.reserve(objectCapacity);
+    bufferGeneration++;
+}
+
+int World::getObjectCapacity() const {
+    return static_cast<int>(objectCapacity);
+}
+
+uint32_t World::getBufferGeneration() const {
+    return bufferGeneration;
+}
+
+void World::compact() {
+    _flushRemovals();
+
+    size_t capacity = max(objectsList.size(), static_cast<size_t>(INITIAL_OBJECT_CAPACITY));
+    if (capacity < objectCapacity) _setObjectCapacity(capacity);
+    objects.shrinkToFit();
+
+    _releasePools();
+    objectPool.shrink_to_fit();
+    idNodePool.shrink_to_fit();
+    pendingRemovals.shrink_to_fit();
+
+    // rehash(0) fits the bucket arrays to the entries.
+    handlesById.rehash(0);
+    collisionSolver.manifolds.rehash(0);
+    collisionSolver.satCache.rehash(0);
+    collisionSolver.pairResults.rehash(0);
+    sensorPairs.rehash(0);
+    sensorOverlaps.rehash(0);
+
+    // Their views are only valid until the next step anyway.
+    for (auto* buffer : {&eventIntData, &sensorEnterData, &sensorExitData}) buffer->shrink_to_fit();
+    eventFloatData.shrink_to_fit();
+    polygonData.shrink_to_fit();
+    freePolygonRecords.shrink_to_fit();
+
+    frameArena.shrinkOnReset();
+
+    memoryStats = MemoryStats();
+    _sampleMemory();
+}
+
+template<typename T, typename A>
+static void _addVector(SubsystemMemory& memory, const vector<T, A>& buffer) {
+    memory.used += buffer.size() * sizeof(T);
+    memory.reserved += buffer.capacity() * sizeof(T);
+}
+
+// An estimate: a node per entry (the value and a next pointer, plus the cached hash) and the
+// bucket array.
+template<typename K, typename V>
+static void _addMap(SubsystemMemory& memory, const unordered_map<K, V>& map) {
+    size_t bytes = map.size() * (sizeof(typename unordered_map<K, V>::value_type) + 2 * sizeof(void*))
+        + map.bucket_count() * sizeof(void*);
+    memory.used += bytes;
+    memory.reserved += bytes;
+}
+
+// Measure every subsystem and raise the high-water marks. Only looks at sizes, except for the
+// overlap lists of the sensors.
+void World::_sampleMemory() {
+    MemoryStats stats;
+
+    SubsystemMemory& objectMemory = stats.objects;
+    _addVector(objectMemory, liveFloatData);
+    _addVector(objectMemory, liveIntData);
+    _addVector(objectMemory, previousTransforms);
+    _addVector(objectMemory, renderData);
+    _addVector(objectMemory, shapeCache);
+    _addVector(objectMemory, movedInStep);
+    _addVector(objectMemory, queuedForces);
+    _addVector(objectMemory, objectsList);
+    _addVector(objectMemory, slotIndices);
+    _addVector(objectMemory, pendingRemovals);
+    _addVector(objectMemory, objectPool);
+    objectMemory.used += objects.bytesUsed() + objects.size() * sizeof(PhysicalObject);
+    objectMemory.reserved += objects.bytesReserved() + (objects.size() + objectPool.size()) * sizeof(PhysicalObject);
+
+    stats.bvh.used = bvh.liveNodeCount() * sizeof(TreeNode);
+    stats.bvh.reserved = (bvh.liveNodeCount() + bvh.freeNodeCount()) * sizeof(TreeNode);
+
+    _addMap(stats.contacts, collisionSolver.manifolds);
+    _addMap(stats.contacts, collisionSolver.satCache);
+    _addMap(stats.contacts, collisionSolver.pairResults);
+    _addMap(stats.contacts, sensorPairs);
+    _addMap(stats.contacts, sensorOverlaps);
+    for (auto& [sensor, overlaps] : sensorOverlaps) _addVector(stats.contacts, overlaps);
+    stats.contacts.used += materials.bytesUsed();
+    stats.contacts.reserved += materials.bytesReserved();
+
+    stats.frameArena.used = frameArena.used();
+    stats.frameArena.reserved = frameArena.reserved();
+
+    _addMap(stats.lookup, handlesById);
+    _addVector(stats.lookup, idNodePool);
+    // Pooled entries are unlinked nodes of handlesById.
+    stats.lookup.reserved += idNodePool.size() * (sizeof(pair<const int, uint32_t>) + 2 * sizeof(void*));
+
+    _addVector(stats.events, eventIntData);
+    _addVector(stats.events, eventFloatData);
+    _addVector(stats.events, sensorEnterData);
+    _addVector(stats.events, sensorExitData);
+
+    _addVector(stats.staging, stagingFloatData);
+    _addVector(stats.staging, stagingIntData);
+    _addVector(stats.staging, stagingHandles);
+
+    _addVector(stats.shapes, polygonData);
+    _addVector(stats.shapes, freePolygonRecords);
+    _addVector(stats.shapes, tilemap.solid);
+    _addVector(stats.shapes, tilemap.cellRects);
+    _addVector(stats.shapes, tilemap.rects);
+
+    static SubsystemMemory MemoryStats::* const subsystems[] = {
+        &MemoryStats::objects, &MemoryStats::bvh, &MemoryStats::contacts, &MemoryStats::frameArena,
+        &MemoryStats::lookup, &MemoryStats::events, &MemoryStats::staging, &MemoryStats::shapes,
+    };
+    for (auto subsystem : subsystems) {
+        stats.total.used += (stats.*subsystem).used;
+        stats.total.reserved += (stats.*subsystem).reserved;
+        (stats.*subsystem).highWater = max((memoryStats.*subsystem).highWater, (stats.*subsystem).used);
+    }
+    stats.total.highWater = max(memoryStats.total.highWater, stats.total.used);
+    // The arena tracks its own, across every allocation of a step rather than at its end.
+    stats.frameArena.highWater = frameArena.highWaterMark();
+
+    memoryStats = stats;
+}
+
+MemoryStats World::getMemoryStats() {
+    _sampleMemory();
+    return memoryStats;
+}
+
+// Fill the holes left by removed objects with the last records, from the highest hole down, so the
+// records moved are never holes themselves.
+void World::_flushRemovals() {
+    if (pendingRemovals.empty()) return;
+
+    sort(pendingRemovals.begin(), pendingRemovals.end(), greater<int>());
+
+    for (int hole : pendingRemovals) {
+        int last = static_cast<int>(objectsList.size()) - 1;
+
+        if (hole != last) {
+            copy_n(liveIntData.begin() + last * LIVE_INT_EPO, LIVE_INT_EPO, liveIntData.begin() + hole * LIVE_INT_EPO);
+            copy_n(liveFloatData.begin() + last * FDATA_EPO, FDATA_EPO, liveFloatData.begin() + hole * FDATA_EPO);
+            copy_n(previousTransforms.begin() + last * RENDER_EPO, RENDER_EPO, previousTransforms.begin() + hole * RENDER_EPO);
+            copy_n(renderData.begin() + last * RENDER_EPO, RENDER_EPO, renderData.begin() + hole * RENDER_EPO);
+            shapeCache[hole] = shapeCache[last];
+            movedInStep[hole] = movedInStep[last];
+
+            PhysicalObject* moved = objectsList[last];
+            objectsList[hole] = moved;
+            moved->worldIndex = hole;
+            slotIndices[SlotMap<PhysicalObject*>::slotOf(moved->handle)] = hole;
+        }
+
+        objectsList.pop_back();
+        liveIntData.resize(objectsList.size() * LIVE_INT_EPO);
+        liveFloatData.resize(objectsList.size() * FDATA_EPO);
+        previousTransforms.resize(objectsList.size() * RENDER_EPO);
+        renderData.resize(objectsList.size() * RENDER_EPO);
+        shapeCache.pop_back();
+        movedInStep.pop_back();
+    }
+
+    pendingRemovals.clear();
 }
 
 PhysicalObject* World::getObject(int id) const {
-    auto it = objectsMap.find(id);
-    if (it != objectsMap.end()) {
-        return it->second;
+    auto it = handlesById.find(id);
+    if (it != handlesById.end()) {
+        return getObjectByHandle(it->second);
     }
     return nullptr;
 }
 
+PhysicalObject* World::getObjectByHandle(uint32_t handle) const {
+    PhysicalObject* const* object = objects.get(handle);
+    return object ? *object : nullptr;
+}
+
 PhysicalObject* World::getObjectAtIndex(int index) const {
     if (index >= 0 && index < objectsList.size()) {
         return objectsList[index];
@@ -121,16 +492,12 @@ PhysicalObject* World::getObjectAtIndex(int index) const {
 }
 
 int World::findeIndexForObject(int id){
-    auto it = objectsMap.find(id);
-    if (it != objectsMap.end()) {
-        return it->second->worldIndex;
-    }
-    return -1;
-
+    PhysicalObject* object = getObject(id);
+    return object ? object->worldIndex : -1;
 }
 
 int World::getObjectCount() const {
-    return objectsList.size();
+    return static_cast<int>(objects.size());
 }
 
 void World::setGravity(float x, float y) {
@@ -142,24 +509,160 @@ void World::setGravity(float x, float y) {
 
 
 #ifdef EMSCRIPTEN
+// Views of the per-object buffers cover the whole capacity. They stay valid until
+// bufferGeneration changes.
 emscripten_val World::getLiveFloatData() {
-    size_t size = max(static_cast<size_t>(4096u), liveFloatData.size() * 2);
-    return emscripten_val(emscripten::typed_memory_view(size * sizeof(float), liveFloatData.data()));
+    return emscripten_val(emscripten::typed_memory_view(objectCapacity * FDATA_EPO, liveFloatData.data()));
 }
 
 emscripten_val World::getLiveIntData() {
-    size_t size = max(static_cast<size_t>(4096u), liveIntData.size() * 2);
-    return emscripten_val(emscripten::typed_memory_view(size * sizeof(int), liveIntData.data()));
+    return emscripten_val(emscripten::typed_memory_view(objectCapacity * LIVE_INT_EPO, liveIntData.data()));
+}
+
+emscripten_val World::getRenderData() {
+    return emscripten_val(emscripten::typed_memory_view(objectCapacity * RENDER_EPO, renderData.data()));
+}
+
+emscripten_val World::getStagingFloatData() {
+    return emscripten_val(emscripten::typed_memory_view(stagingFloatData.size(), stagingFloatData.data()));
+}
+
+emscripten_val World::getStagingIntData() {
+    return emscripten_val(emscripten::typed_memory_view(stagingIntData.size(), stagingIntData.data()));
+}
+
+emscripten_val World::getStagingHandles() {
+    return emscripten_val(emscripten::typed_memory_view(stagingHandles.size(), stagingHandles.data()));
+}
+
+emscripten_val World::getSlotIndices() {
+    return emscripten_val(emscripten::typed_memory_view(slotIndices.capacity(), slotIndices.data()));
+}
+
+// Views of the event buffers. They are only valid until the next step, which may reallocate them.
+emscripten_val World::getEventIntData() {
+    return emscripten_val(emscripten::typed_memory_view(eventIntData.size(), eventIntData.data()));
+}
+
+emscripten_val World::getEventFloatData() {
+    return emscripten_val(emscripten::typed_memory_view(eventFloatData.size(), eventFloatData.data()));
+}
+
+emscripten_val World::getSensorEnterData() {
+    return emscripten_val(emscripten::typed_memory_view(sensorEnterData.size(), sensorEnterData.data()));
+}
+
+emscripten_val World::getSensorExitData() {
+    return emscripten_val(emscripten::typed_memory_view(sensorExitData.size(), sensorExitData.data()));
 }
 #endif
 
+int World::advance(float elapsedSeconds, int maxSteps) {
+    accumulator += elapsedSeconds;
+
+    int steps = min(static_cast<int>(accumulator / timeStep), max(0, maxSteps));
+
+    // The events of all steps taken are kept.
+    _clearEvents();
+    _flushRemovals();
+    for(int i = 0; i < steps; i++){
+        // Only the state before the last step is needed for interpolation.
+        if(i == steps - 1) _storePreviousTransforms();
+        _doStep();
+    }
+
+    accumulator -= steps * timeStep;
+
+    // Drop whatever we couldn't catch up on rather than falling further behind every frame.
+    if(accumulator >= timeStep) accumulator = fmod(accumulator, timeStep);
+
+    _publishRenderData();
+    _sampleMemory();
+
+    return steps;
+}
+
+float World::getInterpolationAlpha() const {
+    return accumulator / timeStep;
+}
+
+void World::_storePreviousTransforms() {
+    for(size_t i = 0; i < objectsList.size(); i++){
+        previousTransforms[i * RENDER_EPO + RENDER_X] = liveFloatData[i * FDATA_EPO + FDATA_X];
+        previousTransforms[i * RENDER_EPO + RENDER_Y] = liveFloatData[i * FDATA_EPO + FDATA_Y];
+        previousTransforms[i * RENDER_EPO + RENDER_R] = liveFloatData[i * FDATA_EPO + FDATA_R];
+    }
+}
+
+void World::_publishRenderData() {
+    float alpha = getInterpolationAlpha();
+
+    for(size_t i = 0; i < objectsList.size(); i++){
+        float* previous = &previousTransforms[i * RENDER_EPO];
+        float* render = &renderData[i * RENDER_EPO];
+        render[RENDER_X] = previous[RENDER_X] + (liveFloatData[i * FDATA_EPO + FDATA_X] - previous[RENDER_X]) * alpha;
+        render[RENDER_Y] = previous[RENDER_Y] + (liveFloatData[i * FDATA_EPO + FDATA_Y] - previous[RENDER_Y]) * alpha;
+        render[RENDER_R] = previous[RENDER_R] + (liveFloatData[i * FDATA_EPO + FDATA_R] - previous[RENDER_R]) * alpha;
+    }
+}
+
 void World::step() {
-    _doKinematics();
-    _doBroadPhase();
-    _doNarrowPhase();
-    _doResolution();
-    // _doConstraints();
-    // _doStabilization(); // Optional.
+    _clearEvents();
+    _flushRemovals();
+    _doStep();
+    _sampleMemory();
+}
+
+void World::_doStep() {
+    // Nothing from the previous step's per-step buffers is used past this point.
+    frameArena.reset();
+
+    if(substeps > 1){
+        _doSubsteps();
+    }
+    else {
+        _doKinematics();
+        _doBroadPhase();
+        _doNarrowPhase();
+        _doResolution();
+        // _doConstraints();
+        // _doStabilization(); // Optional.
+    }
+
+    _publishEvents();
+}
+
+void World::_clearEvents() {
+    eventIntData.assign(EVENT_HEADER, 0);
+    eventFloatData.clear();
+    sensorEnterData.assign(SENSOR_EVENT_HEADER, 0);
+    sensorExitData.assign(SENSOR_EVENT_HEADER, 0);
+}
+
+// Append the step's collision events: a begin or persist record per contact, after resolution so
+// it carries the impulse, and an end record per contact that was dropped.
+void World::_publishEvents() {
+    for (auto& collision : collisionSolver.collisions) {
+        const ContactManifold& manifold = *collision.manifold;
+        CollisionEventType type = manifold.firstStamp == collisionSolver.manifoldStamp
+            ? CollisionEventType::BEGIN : CollisionEventType::PERSIST;
+        eventIntData.insert(eventIntData.end(), {static_cast<int>(type), manifold.idA, manifold.idB});
+        eventFloatData.insert(eventFloatData.end(), {
+            collision.normal.x, collision.normal.y, collision.normalImpulseMagnitude,
+            collision.contactPoint.x, collision.contactPoint.y
+        });
+    }
+
+    for (auto& manifold : collisionSolver.endedManifolds) {
+        Vec2 point;
+        for (int i = 0; i < manifold.pointCount; i++) point = point + manifold.points[i].point;
+        if (manifold.pointCount > 0) point = point / static_cast<float>(manifold.pointCount);
+
+        eventIntData.insert(eventIntData.end(), {static_cast<int>(CollisionEventType::END), manifold.idA, manifold.idB});
+        eventFloatData.insert(eventFloatData.end(), {manifold.normal.x, manifold.normal.y, 0.0f, point.x, point.y});
+    }
+
+    eventIntData[0] = static_cast<int>((eventIntData.size() - EVENT_HEADER) / EVENT_INT_EPO);
 }
 
 // 1. Kinematics.
@@ -175,9 +678,11 @@ void World::_doKinematics(){
         
         // Physics step.
         bool moved = object->stepMovement(timeStep);
+        movedInStep[object->worldIndex] |= moved;
 
-        // Recompute AABB and update BVH.
+        // Rebuild the cached outline, recompute AABB and update BVH.
         if(moved){
+            _updateShape(object);
             bool treeNeedsUpdate = object->recomputeAabb(false);
 
             if(treeNeedsUpdate){
@@ -192,132 +697,323 @@ void World::_doBroadPhase(){
     bvh.traverseAndCheckCollisions();
 }
 
+// Pairs that can't produce a response: neither object can move, or a sensor on something that
+// can't move.
+static bool _isInertPair(int typeA, int typeB) {
+    int fixed = static_cast<int>(ObjectType::FIXED_OBJECT);
+    int sensor = static_cast<int>(ObjectType::SENSOR);
+    if(typeA == fixed) return typeB == fixed || typeB == sensor;
+    if(typeB == fixed) return typeA == sensor;
+    return false;
+}
+
 // 3. Narrow phase collision detection.
+// Pairs whose objects have not moved since the last narrow phase reuse its result.
 void World::_doNarrowPhase(){
     collisionSolver.clear();
+    sensorStamp++;
     
     for (auto& pair : bvh.collisionPairs) {
         PhysicalObject* obj1 = static_cast<PhysicalObject*>(pair.first);
         PhysicalObject* obj2 = static_cast<PhysicalObject*>(pair.second);
-        
+        int index1 = obj1->worldIndex;
+        int index2 = obj2->worldIndex;
 
-        // Perform narrow phase collision detection between obj1 and obj2
-        auto colliding = collisionSolver.solve(obj1->worldIndex, obj2->worldIndex);
+        int type1 = liveIntData[index1 * LIVE_INT_EPO + LIVE_INT_TYPE];
+        int type2 = liveIntData[index2 * LIVE_INT_EPO + LIVE_INT_TYPE];
+        if(_isInertPair(type1, type2)) continue;
 
-        liveIntData[obj1->worldIndex * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_AABB_COLLISION | (colliding * HAS_PHYSICAL_COLLISION);
-        liveIntData[obj2->worldIndex * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_AABB_COLLISION | (colliding * HAS_PHYSICAL_COLLISION);
+        liveIntData[obj1->worldIndex * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_AABB_COLLISION;
+        liveIntData[obj2->worldIndex * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_AABB_COLLISION;
+
+        int sensor = static_cast<int>(ObjectType::SENSOR);
+        if(type1 == sensor || type2 == sensor){
+            _updateSensorPair(index1, index2);
+            continue;
+        }
+
+        bool atRest = !movedInStep[index1] && !movedInStep[index2];
+        if(!atRest || !collisionSolver.reusePair(index1, index2)){
+            collisionSolver.addPair(index1, index2, atRest);
+        }
     }
+
+    _endSensorPairs();
+
+    // Perform narrow phase collision detection, batched by shape pair.
+    collisionSolver.solvePairs();
+    _doTerrain();
+
+    for (auto& collision : collisionSolver.collisions) {
+        liveIntData[collision.indexA * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_PHYSICAL_COLLISION;
+        if(collision.indexB != TERRAIN_INDEX){
+            liveIntData[collision.indexB * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_PHYSICAL_COLLISION;
+        }
+    }
+
+    collisionSolver.updateManifolds();
+
+    fill(movedInStep.begin(), movedInStep.end(), 0);
 }
 
-// 4. Collision resolution.
-void World::_doResolution(){
-    for (auto& collisionInfo : collisionSolver.collisions) {
-        PhysicalObject* objA = objectsList[collisionInfo.indexA];
-        PhysicalObject* objB = objectsList[collisionInfo.indexB];
+// Track the overlap of a sensor pair. Pairs whose objects haven't moved keep their state untested.
+void World::_updateSensorPair(int indexA, int indexB){
+    int idA = liveIntData[indexA * LIVE_INT_EPO + LIVE_INT_ID];
+    int idB = liveIntData[indexB * LIVE_INT_EPO + LIVE_INT_ID];
+    auto [it, isNew] = sensorPairs.try_emplace(makePairKey(idA, idB));
+    SensorPair& pair = it->second;
+    pair.stamp = sensorStamp;
+
+    if(isNew){
+        int sensor = static_cast<int>(ObjectType::SENSOR);
+        pair.idA = idA;
+        pair.idB = idB;
+        pair.sensorA = liveIntData[indexA * LIVE_INT_EPO + LIVE_INT_TYPE] == sensor;
+        pair.sensorB = liveIntData[indexB * LIVE_INT_EPO + LIVE_INT_TYPE] == sensor;
+        pair.overlapping = false;
+    }
 
-        if(hasPenetrationResolution) __doPenetrationResolution(collisionInfo, objA, objB);
-        if(hasRestitution) __doRestitution(collisionInfo, objA, objB);
-        if(hasFriction) __doCollisionFriction(collisionInfo, objA, objB);
+    if(isNew || movedInStep[indexA] || movedInStep[indexB]){
+        bool overlapping = collisionSolver.overlaps(indexA, indexB);
+        if(overlapping != pair.overlapping) _setSensorOverlap(pair, overlapping);
+    }
+
+    if(pair.overlapping){
+        liveIntData[indexA * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_PHYSICAL_COLLISION;
+        liveIntData[indexB * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] |= HAS_PHYSICAL_COLLISION;
     }
 }
 
-// 4.a. Penetration resolution.
-void World::__doPenetrationResolution(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject*  objB){
-        
-    // Note that this isn't the same as the inverse of total mass.
-    float imA = objA->getInverseMass();
-    float imB = objB->getInverseMass();
-    float totalInverseMass = imA + imB;
+// Pairs that left the broad phase (or lost an object) stop overlapping. Scans every pair, the ones
+// still overlapping included.
+void World::_endSensorPairs(){
+    for (auto it = sensorPairs.begin(); it != sensorPairs.end(); ) {
+        if(it->second.stamp == sensorStamp){
+            ++it;
+            continue;
+        }
 
-    if(totalInverseMass == 0.0f){
-        return;
+        if(it->second.overlapping) _setSensorOverlap(it->second, false);
+        it = sensorPairs.erase(it);
     }
-    else{
-        Vec2 correction = collisionInfo.normal * (collisionInfo.penetrationDepth / totalInverseMass);
-        
-        Vec2 pA = objA->getPosition();
-        Vec2 pB = objB->getPosition();
+}
+
+void World::_setSensorOverlap(SensorPair& pair, bool overlapping){
+    pair.overlapping = overlapping;
+    vector<int>& events = overlapping ? sensorEnterData : sensorExitData;
 
-        Vec2 cpA = pA - correction * imA;
-        Vec2 cpB = pB + correction * imB;
+    for (int side = 0; side < 2; side++) {
+        if(!(side == 0 ? pair.sensorA : pair.sensorB)) continue;
+        int sensorId = side == 0 ? pair.idA : pair.idB;
+        int otherId = side == 0 ? pair.idB : pair.idA;
 
-        objA->setPosition(cpA);
-        objB->setPosition(cpB);
+        events.insert(events.end(), {sensorId, otherId});
+        events[0]++;
+
+        if(overlapping) sensorOverlaps[sensorId].push_back(otherId);
+        else {
+            auto found = sensorOverlaps.find(sensorId);
+            if(found == sensorOverlaps.end()) continue;
+
+            vector<int>& ids = found->second;
+            auto id = find(ids.begin(), ids.end(), otherId);
+            if(id != ids.end()){
+                *id = ids.back();
+                ids.pop_back();
+            }
+            if(ids.empty()) sensorOverlaps.erase(found);
+        }
     }
 }
 
-// 4.b. Collision impulse.
-void World::__doRestitution(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject* objB){
-    float totalInverseMass = objA->getInverseMass() + objB->getInverseMass();
-    
-    // Relative velocity.
-    Vec2 rv = objB->getVelocity() - objA->getVelocity();
+vector<int> World::getSensorOverlaps(int id) const {
+    auto it = sensorOverlaps.find(id);
+    return it != sensorOverlaps.end() ? it->second : vector<int>();
+}
 
-    // Relative velocity along the normal.
-    float velAlongNormal = rv.dot(collisionInfo.normal);
+// Bodies against the static terrain. Each body looks up the tiles under it in the tilemap's grid.
+void World::_doTerrain(){
+    if(tilemap.empty()) return;
 
-    // Do not resolve if velocities are separating.
-    if (velAlongNormal > 0) {
-        return;
+    int rigidBody = static_cast<int>(ObjectType::RIGID_BODY);
+    for (size_t i = 0; i < objectsList.size(); i++) {
+        if(liveIntData[i * LIVE_INT_EPO + LIVE_INT_TYPE] != rigidBody) continue;
+        collisionSolver.solveTerrain(static_cast<int>(i), tilemap);
     }
+}
 
-    // Calculate restitution.
-    float e = max(objA->getRestitution(), objB->getRestitution());
-    float j = -(1 + e) * velAlongNormal / totalInverseMass;
+// 4. Collision resolution.
+// Contacts are solved together by the impulse solver, warm started from the persistent manifolds.
+void World::_doResolution(){
+    impulseSolver.solve(collisionSolver.collisions);
+}
 
-    // Apply impulse.
-    auto impulse = collisionInfo.normal * j;
+// Substepped alternative to steps 1-4, for large time steps.
+// The broad and narrow phases run once, on the state left by the previous step; the fat AABBs are
+// padded by velocity and cover this step's motion. The bodies are then integrated and the contacts
+// relaxed substeps times at timeStep / substeps, and the bounds are updated once at the end.
+void World::_doSubsteps(){
+    // Transforms written from JS since the last step invalidate cached pair results too. The
+    // collision passes run before anything is integrated, so bring the rotation, shape and bounds
+    // of those objects up to date first, or they'd be collided at their old pose.
+    for (auto& object : objectsList) {
+        liveIntData[object->worldIndex * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION] = 0;
+        if(!object->wasMovedExternally()) continue;
 
-    // impulse.x = -impulse.x;
-    // impulse.y = -impulse.y;
+        movedInStep[object->worldIndex] = 1;
+        object->syncRotation();
+        _updateShape(object);
+        if(object->recomputeAabb(false)){
+            bvh.update(object->bvhNode, object->aabb);
+        }
+    }
 
-    objA->applyImpulse(impulse * -1.0f, collisionInfo.contactPoint - objA->getPosition());
-    objB->applyImpulse(impulse, collisionInfo.contactPoint - objB->getPosition());
+    _doBroadPhase();
+    _doNarrowPhase();
+
+    float h = timeStep / substeps;
+    impulseSolver.beginSubsteps(collisionSolver.collisions, h, substeps);
+
+    // Forces queued from JS act for the whole step. Queued impulses are applied once.
+    int count = static_cast<int>(objectsList.size());
+    queuedForces.resize(count * 2);
+    for (int i = 0; i < count; i++) {
+        queuedForces[i * 2] = liveFloatData[i * FDATA_EPO + FDATA_NFX];
+        queuedForces[i * 2 + 1] = liveFloatData[i * FDATA_EPO + FDATA_NFY];
+    }
+
+    for (int s = 0; s < substeps; s++) {
+        for (auto& object : objectsList) {
+            int i = object->worldIndex;
+            float m = liveFloatData[i * FDATA_EPO + FDATA_M];
+            liveFloatData[i * FDATA_EPO + FDATA_NFX] = queuedForces[i * 2] + gravity.x * m;
+            liveFloatData[i * FDATA_EPO + FDATA_NFY] = queuedForces[i * 2 + 1] + gravity.y * m;
+            object->integrateVelocity(h);
+        }
+
+        impulseSolver.solveSubstep(true);
+
+        for (auto& object : objectsList) {
+            movedInStep[object->worldIndex] |= object->integratePosition(h);
+        }
+
+        impulseSolver.solveSubstep(false);
+    }
+
+    impulseSolver.endSubsteps();
+
+    for (auto& object : objectsList) {
+        if(!movedInStep[object->worldIndex]) continue;
 
-    collisionInfo.normalImpulseMagnitude = impulse.magnitude();
+        _updateShape(object);
+        if(object->recomputeAabb(false)){
+            bvh.update(object->bvhNode, object->aabb);
+        }
+    }
 }
 
-// 4.c. Collision friction.
-void World::__doCollisionFriction(CollisionInfo& collisionInfo, PhysicalObject* objA, PhysicalObject* objB){
-    // Compute the lever arms (from center of mass to contact point)
-    Vec2 rA = collisionInfo.contactPoint - objA->getPosition();
-    Vec2 rB = collisionInfo.contactPoint - objB->getPosition();
 
-    // Compute the tangential velocities due to rotation
-    Vec2 tangentialVelocityA = Vec2(-rA.y * objA->getAngularVelocity(), rA.x * objA->getAngularVelocity()); // Cross product in 2D
-    Vec2 tangentialVelocityB = Vec2(-rB.y * objB->getAngularVelocity(), rB.x * objB->getAngularVelocity());
+bool World::setPolygon(int id, const vector<float>& points) {
+    PhysicalObject* object = getObject(id);
+    if (!object) return false;
 
-    // Compute the total velocity at the point of contact (linear + tangential)
-    Vec2 contactVelocityA = objA->getVelocity() + tangentialVelocityA;
-    Vec2 contactVelocityB = objB->getVelocity() + tangentialVelocityB;
+    int index = object->worldIndex;
+    int& offset = liveIntData[index * LIVE_INT_EPO + LIVE_INT_SHAPE_DATA];
 
-    // Compute the relative velocity at the point of contact
-    Vec2 relativeVelocity = contactVelocityB - contactVelocityA;
+    // Reuse the object's record, then a released one, then grow the pool.
+    int target = offset;
+    if (target < 0) target = freePolygonRecords.empty() ? static_cast<int>(polygonData.size()) : freePolygonRecords.back();
 
-    // Remove the normal component of the relative velocity to get the tangential component
-    Vec2 relativeNormalComponent = collisionInfo.normal * (relativeVelocity.dot(collisionInfo.normal));
-    Vec2 tangentialVelocity = relativeVelocity - relativeNormalComponent;
+    float radius = writePolygonRecord(polygonData, target, points);
+    if (radius < 0.0f) return false;
 
-    // If the object is nearly stationary in the tangential direction, apply static friction
-    if (tangentialVelocity.magnitude() < 0.001f) {
-        // Static friction case: cancel out the tangential velocity
-        float maxStaticFriction = min(objA->getStaticFriction(), objB->getStaticFriction());
-        Vec2 staticFrictionImpulse = tangentialVelocity * -maxStaticFriction;
+    if (offset < 0 && !freePolygonRecords.empty() && freePolygonRecords.back() == target) freePolygonRecords.pop_back();
+    offset = target;
 
-        // Apply static friction (impulse)
-        objA->applyImpulse(staticFrictionImpulse, collisionInfo.contactPoint - objA->getPosition());
-        objB->applyImpulse(staticFrictionImpulse * -1.0f, collisionInfo.contactPoint - objB->getPosition());
-    } else {
-        // Dynamic friction case: reduce sliding velocity
-        float frictionCoefficient = min(objA->getKineticFriction(), objB->getKineticFriction());
-        Vec2 dynamicFrictionImpulse = tangentialVelocity.normalize() * -frictionCoefficient * collisionInfo.normalImpulseMagnitude;
+    object->shape = ObjectShape::POLYGON;
+    liveIntData[index * LIVE_INT_EPO + LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::POLYGON);
+    liveFloatData[index * FDATA_EPO + FDATA_RADIUS] = radius;
+    movedInStep[index] = 1;
 
-        // Apply dynamic friction (impulse)
-        objA->applyImpulse(dynamicFrictionImpulse * -1.0f, collisionInfo.contactPoint - objA->getPosition());
-        objB->applyImpulse(dynamicFrictionImpulse, collisionInfo.contactPoint - objB->getPosition());
+    _updateShape(object);
+    if (object->recomputeAabb(false)) bvh.update(object->bvhNode, object->aabb);
+
+    return true;
+}
+
+bool World::setCompound(int id, const vector<float>& children) {
+    PhysicalObject* object = getObject(id);
+    if (!object) return false;
+
+    Compound* compound = new Compound();
+    if (!buildCompound(children, *compound)) {
+        delete compound;
+        return false;
     }
+
+    delete object->compound;
+    object->compound = compound;
+
+    int index = object->worldIndex;
+    object->shape = ObjectShape::COMPOUND;
+    liveIntData[index * LIVE_INT_EPO + LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::COMPOUND);
+    if (object->type != ObjectType::FIXED_OBJECT && compound->mass > 0.0f) object->setMass(compound->mass);
+
+    // The children were re-centered on their center of mass. Move the body there so they stay put.
+    const ShapeCache& cache = shapeCache[index];
+    Vec2 shift = cache.axisX * compound->centerOfMass.x + cache.axisY * compound->centerOfMass.y;
+    object->setPosition(object->getPosition() + shift);
+    movedInStep[index] = 1;
+
+    _updateShape(object);
+    if (object->recomputeAabb(false)) bvh.update(object->bvhNode, object->aabb);
+
+    return true;
+}
+
+bool World::setTilemap(int columns, int rows, float tileSize, float x, float y, const vector<int>& tiles) {
+    if (!tilemap.set(columns, rows, tileSize, Vec2(x, y), tiles)) return false;
+
+    // Contacts against the old terrain would carry impulses over to unrelated rectangles. Contacts
+    // between objects keep theirs.
+    collisionSolver.dropTerrainManifolds();
+    return true;
 }
 
+void World::setTerrainMaterial(float restitution, float staticFriction, float kineticFriction) {
+    materials.set(TERRAIN_MATERIAL, Material{restitution, staticFriction, kineticFriction, 0.0f, 0.0f});
+}
+
+int World::addMaterial(float restitution, float staticFriction, float kineticFriction, float linearDamping, float angularDamping) {
+    return materials.add(Material{restitution, staticFriction, kineticFriction, linearDamping, angularDamping});
+}
+
+bool World::setMaterial(int material, float restitution, float staticFriction, float kineticFriction, float linearDamping, float angularDamping) {
+    return materials.set(material, Material{restitution, staticFriction, kineticFriction, linearDamping, angularDamping});
+}
+
+bool World::setObjectCoefficients(int id, const Material& coefficients) {
+    PhysicalObject* object = getObject(id);
+    return object && object->setCoefficients(coefficients);
+}
+
+bool World::setObjectMaterial(int id, int material) {
+    PhysicalObject* object = getObject(id);
+    return object && object->setMaterial(material);
+}
+
+// Rebuild the object's cached world space geometry, including compound children.
+void World::_updateShape(PhysicalObject* object) {
+    int index = object->worldIndex;
+    ShapeCache& cache = shapeCache[index];
+    updateShapeCache(liveIntData, liveFloatData, index, cache, polygonData);
+
+    cache.compound = object->compound;
+    if (object->compound) {
+        Vec2 position(liveFloatData[index * FDATA_EPO + FDATA_X], liveFloatData[index * FDATA_EPO + FDATA_Y]);
+        updateCompoundGeometry(*object->compound, position, cache.axisX);
+    }
+}
 
 void World::setTimeStep(float dt) {
     timeStep = dt;
@@ -336,18 +1032,36 @@ void World::setTimeStep(float dt) {
 void World::clear() {
     bvh.clear();
     collisionSolver.clear();
+    collisionSolver.clearManifolds();
+    impulseSolver.clear();
 
     for (auto& object : objectsList) {
-        delete object;
+        if (!object) continue;
+        materials.release(object->getMaterial());
+        _releaseObject(object);
     }
 
     // Clear the lists
 
-    objectsMap.clear();
+    objects.clear();
+    handlesById.clear();
     objectsList.clear();
+    pendingRemovals.clear();
+    slotIndices.clear();
 
     liveIntData.clear();
     liveFloatData.clear();
+    previousTransforms.clear();
+    renderData.clear();
+    shapeCache.clear();
+    movedInStep.clear();
+    polygonData.clear();
+    freePolygonRecords.clear();
+    tilemap.clear();
+    sensorPairs.clear();
+    sensorOverlaps.clear();
+    _clearEvents();
+    accumulator = 0.0f;
 
     // objectsList.resize(0);
     // liveIntData.resize(0);
@@ -359,6 +1073,12 @@ void World::destroy(){
 }
 
 
-void World::setHasPenetrationResolution(bool value){ hasPenetrationResolution = value; }
-void World::setHasRestitution(bool value){ hasRestitution = value; }
-void World::setHasFriction(bool value){ hasFriction = value; }
\ No newline at end of file
+void World::setHasPenetrationResolution(bool value){ impulseSolver.hasPenetrationResolution = value; }
+void World::setHasRestitution(bool value){ impulseSolver.hasRestitution = value; }
+void World::setHasFriction(bool value){ impulseSolver.hasFriction = value; }
+void World::setHasWarmStarting(bool value){ impulseSolver.hasWarmStarting = value; }
+
+void World::setVelocityIterations(int iterations){ impulseSolver.velocityIterations = max(1, iterations); }
+void World::setPositionIterations(int iterations){ impulseSolver.positionIterations = max(0, iterations); }
+void World::setThreadCount(int count){ impulseSolver.workerPool.setThreadCount(count); }
+void World::setSubsteps(int count){ substeps = max(1, count); }
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include <cstdlib>
+#include <new>
+#include "allocation-counter.h"
+
+using namespace std;
+
+static bool _countAllocations = false;
+static size_t _allocationCount = 0;
+
+void* operator new(size_t size) {
+    if (_countAllocations) _allocationCount++;
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) throw bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+
+void startCountingAllocations() {
+    _allocationCount = 0;
+    _countAllocations = true;
+}
+
+size_t stopCountingAllocations() {
+    _countAllocations = false;
+    return _allocationCount;
+}
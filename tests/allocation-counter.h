@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts heap allocations between startCountingAllocations and stopCountingAllocations, which
+// returns the count. allocation-counter.cpp replaces the global operator new for the whole test
+// binary to do it.
+void startCountingAllocations();
+size_t stopCountingAllocations();
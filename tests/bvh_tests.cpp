@@ -929,4 +929,108 @@ TEST(BvhTest, TraverseAndCheckCollisions_MultipleCollisions) {
     EXPECT_EQ(expectedCollisions, actualCollisions);
 }
 
+// Internal bounds must cover every leaf for the traversal to prune correctly, including after
+// leaves are inserted deep in the tree and moved.
+TEST(BvhTest, TraverseAndCheckCollisions_DeepTreeReportsEachPairOnce) {
+    Bvh bvh;
+
+    vector<TreeNode*> nodes;
+    for (int i = 0; i < 16; i++) {
+        nodes.push_back(bvh.insert(createAabb(i * 2.0f, 0.0f, i * 2.0f + 1.0f, 1.0f), (void*)(intptr_t)(i + 1)));
+    }
+
+    bvh.traverseAndCheckCollisions();
+    EXPECT_EQ(bvh.collisionPairs.size(), 0);
+
+    // Move the first leaf onto the last one.
+    bvh.update(nodes[0], createAabb(30.5f, 0.5f, 31.5f, 1.5f));
+    bvh.traverseAndCheckCollisions();
+
+    ASSERT_EQ(bvh.collisionPairs.size(), 1);
+    set<void*> pair = {bvh.collisionPairs[0].first, bvh.collisionPairs[0].second};
+    EXPECT_EQ(pair, (set<void*>{(void*)1, (void*)16}));
+}
+
+// Removing a leaf tightens the bounds of every ancestor, up to the root.
+TEST(BvhTest, Remove_RefitsAncestors) {
+    Bvh bvh;
+
+    vector<TreeNode*> nodes;
+    for (int i = 0; i < 8; i++) {
+        nodes.push_back(bvh.insert(createAabb(i * 2.0f, 0.0f, i * 2.0f + 1.0f, 1.0f), (void*)(intptr_t)(i + 1)));
+    }
+    TreeNode* far = bvh.insert(createAabb(100.0f, 100.0f, 101.0f, 101.0f), (void*)100);
+    EXPECT_EQ(bvh._root->aabb.max.x, 101.0f);
+
+    bvh.remove(far);
+    EXPECT_EQ(bvh._root->aabb.max.x, 15.0f);
+    EXPECT_EQ(bvh._root->aabb.max.y, 1.0f);
+
+    // Every internal node is exactly the union of its children.
+    bvh.remove(nodes[7]);
+    vector<TreeNode*> stack = {bvh._root};
+    while (!stack.empty()) {
+        TreeNode* node = stack.back();
+        stack.pop_back();
+        if (node->isLeaf()) continue;
+        ASSERT_TRUE(node->left && node->right);
+        EXPECT_EQ(node->aabb.min.x, min(node->left->aabb.min.x, node->right->aabb.min.x));
+        EXPECT_EQ(node->aabb.max.x, max(node->left->aabb.max.x, node->right->aabb.max.x));
+        stack.push_back(node->left);
+        stack.push_back(node->right);
+    }
+    EXPECT_EQ(bvh._root->aabb.max.x, 13.0f);
+}
+
+// The traversal prunes disjoint subtrees, so it must still find exactly the overlapping pairs a
+// brute force check does, each once, as leaves are inserted, moved and removed.
+TEST(BvhTest, TraverseAndCheckCollisions_MatchesBruteForce) {
+    Bvh bvh;
+
+    // A deterministic scatter of boxes of mixed sizes.
+    unsigned int seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<float>((seed >> 8) % 1000) / 1000.0f;
+    };
+    auto randomAabb = [&next]() {
+        float x = next() * 40.0f, y = next() * 40.0f;
+        return createAabb(x, y, x + 0.5f + next() * 4.0f, y + 0.5f + next() * 4.0f);
+    };
+
+    vector<TreeNode*> nodes;
+    for (int i = 0; i < 200; i++) nodes.push_back(bvh.insert(randomAabb(), (void*)(intptr_t)(i + 1)));
+
+    auto check = [&]() {
+        set<pair<void*, void*>> expected;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            for (size_t j = i + 1; j < nodes.size(); j++) {
+                if (!nodes[i] || !nodes[j] || !nodes[i]->aabb.overlaps(nodes[j]->aabb)) continue;
+                void* a = nodes[i]->userData;
+                void* b = nodes[j]->userData;
+                expected.insert({min(a, b), max(a, b)});
+            }
+        }
+
+        bvh.traverseAndCheckCollisions();
+        set<pair<void*, void*>> actual;
+        for (auto& collision : bvh.collisionPairs) {
+            void* a = collision.first;
+            void* b = collision.second;
+            actual.insert({min(a, b), max(a, b)});
+        }
+        EXPECT_EQ(bvh.collisionPairs.size(), actual.size());
+        EXPECT_EQ(actual, expected);
+    };
+
+    check();
+    for (int i = 0; i < 200; i += 3) bvh.update(nodes[i], randomAabb());
+    check();
+    for (int i = 1; i < 200; i += 4) {
+        bvh.remove(nodes[i]);
+        nodes[i] = nullptr;
+    }
+    check();
+}
+
 #endif
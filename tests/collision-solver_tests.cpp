@@ -1,3 +1,7 @@
+#include <gtest/gtest.h>
+#include "collision-solver.h"
+#include "constants.h"
+
 // #include "world.h"
 // #include "physical-object.h"
 // #include "collision-solver.h"
@@ -86,3 +90,405 @@
 //     EXPECT_FLOAT_EQ(result.normal.y, 0.0f);
 // }
 
+// Helper function to append a box to raw live data.
+void pushBox(vector<int>& intData, vector<float>& floatData, int id, ObjectShape shape, float x, float y, float w, float h, float r) {
+    intData.insert(intData.end(), {id, static_cast<int>(shape), static_cast<int>(ObjectType::RIGID_BODY), 0, -1, DEFAULT_MATERIAL});
+
+    vector<float> data(FDATA_EPO, 0.0f);
+    data[FDATA_X] = x;
+    data[FDATA_Y] = y;
+    data[FDATA_R] = r;
+    data[FDATA_COS] = cos(r);
+    data[FDATA_SIN] = sin(r);
+    data[FDATA_W] = w;
+    data[FDATA_H] = h;
+    floatData.insert(floatData.end(), data.begin(), data.end());
+}
+
+// A box resting flat on another box gets a two point manifold along the shared face.
+TEST(CollisionSolverTest, BoxOnBoxHasTwoContactPoints) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::BOX, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 0.5f, 1.9f, 2.0f, 2.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    ASSERT_TRUE(solver.solve(0, 1));
+    ASSERT_EQ(solver.collisions.size(), 1);
+
+    const CollisionInfo& info = solver.collisions[0];
+    EXPECT_NEAR(info.normal.x, 0.0f, 1e-5f);
+    EXPECT_NEAR(info.normal.y, 1.0f, 1e-5f);
+    ASSERT_EQ(info.pointCount, 2);
+    EXPECT_NEAR(info.points[0].penetrationDepth, 0.1f, 1e-5f);
+    EXPECT_NEAR(info.points[1].penetrationDepth, 0.1f, 1e-5f);
+    EXPECT_NE(info.points[0].featureId, info.points[1].featureId);
+
+    // The points span the overlap of the two faces.
+    float minX = min(info.points[0].point.x, info.points[1].point.x);
+    float maxX = max(info.points[0].point.x, info.points[1].point.x);
+    EXPECT_NEAR(minX, -0.5f, 1e-5f);
+    EXPECT_NEAR(maxX, 1.0f, 1e-5f);
+}
+
+// Rotated boxes whose bounds overlap but whose shapes don't are rejected.
+TEST(CollisionSolverTest, RotatedBoxesSeparated) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::BOX, 0.0f, 0.0f, 2.0f, 2.0f, 0.785398f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 2.3f, 2.3f, 2.0f, 2.0f, 0.785398f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    EXPECT_FALSE(solver.solve(0, 1));
+    EXPECT_EQ(solver.collisions.size(), 0);
+}
+
+// The separating axis is remembered per pair, in either order, until the pair stops being tested.
+TEST(CollisionSolverTest, SeparatingAxisIsCachedPerPair) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::BOX, 0.0f, 0.0f, 2.0f, 2.0f, 0.785398f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 2.3f, 2.3f, 2.0f, 2.0f, 0.785398f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    EXPECT_FALSE(solver.solve(0, 1));
+    solver.updateManifolds();
+
+    ASSERT_EQ(solver.satCache.size(), 1);
+    SatCacheEntry entry = solver.satCache[makePairKey(1, 2)];
+    EXPECT_EQ(entry.firstId, 1);
+
+    // The reversed pair starts from the same edge, seen from the other object.
+    solver.clear();
+    EXPECT_FALSE(solver.solve(1, 0));
+    solver.updateManifolds();
+    const SatCacheEntry& reversed = solver.satCache[makePairKey(1, 2)];
+    EXPECT_EQ(reversed.firstId, 2);
+    EXPECT_EQ(reversed.edge, entry.edge);
+    EXPECT_EQ(reversed.flip, 1 - entry.flip);
+
+    // Once the pair drops out of the broad phase, its axis is dropped.
+    solver.clear();
+    solver.updateManifolds();
+    EXPECT_EQ(solver.satCache.size(), 0);
+}
+
+// The batched AABB and circle-box kernels build the same contacts solve() does, including for
+// pairs that don't touch.
+TEST(CollisionSolverTest, BatchedPairsMatchSolve) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::AABB, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::AABB, 1.5f, 0.4f, 2.0f, 1.0f, 0.0f);
+    pushBox(intData, floatData, 3, ObjectShape::AABB, 0.3f, -1.8f, 1.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 4, ObjectShape::AABB, 5.0f, 0.0f, 1.0f, 1.0f, 0.0f);
+    pushBox(intData, floatData, 5, ObjectShape::BOX, 0.0f, 3.0f, 2.0f, 1.0f, 0.6f);
+    pushBox(intData, floatData, 6, ObjectShape::CIRCLE, 0.8f, 3.6f, 0.5f, 0.5f, 0.0f);
+    pushBox(intData, floatData, 7, ObjectShape::CIRCLE, 0.0f, 3.0f, 0.3f, 0.3f, 0.0f);
+    pushBox(intData, floatData, 8, ObjectShape::CIRCLE, 4.0f, 3.0f, 0.5f, 0.5f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+
+    int pairs[][2] = {{0, 1}, {1, 0}, {0, 2}, {2, 1}, {0, 3}, {5, 4}, {4, 6}, {4, 7}};
+    int hits = 0;
+    for (auto& pair : pairs) {
+        solver.clear();
+        solver.addPair(pair[0], pair[1]);
+        solver.solvePairs();
+        vector<CollisionInfo> batched(solver.collisions.begin(), solver.collisions.end());
+
+        solver.clear();
+        solver.solve(pair[0], pair[1]);
+        ASSERT_EQ(batched.size(), solver.collisions.size());
+        if (batched.empty()) continue;
+        hits++;
+
+        const CollisionInfo& a = batched[0];
+        const CollisionInfo& b = solver.collisions[0];
+        EXPECT_EQ(a.indexA, b.indexA);
+        EXPECT_EQ(a.indexB, b.indexB);
+        EXPECT_FLOAT_EQ(a.normal.x, b.normal.x);
+        EXPECT_FLOAT_EQ(a.normal.y, b.normal.y);
+        ASSERT_EQ(a.pointCount, b.pointCount);
+        for (int i = 0; i < a.pointCount; i++) {
+            EXPECT_FLOAT_EQ(a.points[i].point.x, b.points[i].point.x);
+            EXPECT_FLOAT_EQ(a.points[i].point.y, b.points[i].point.y);
+            EXPECT_FLOAT_EQ(a.points[i].penetrationDepth, b.points[i].penetrationDepth);
+            EXPECT_EQ(a.points[i].featureId, b.points[i].featureId);
+        }
+    }
+    EXPECT_EQ(hits, 5);
+}
+
+// A cacheable pair's result is handed back by reusePair on the next step, while the objects keep
+// their indices.
+TEST(CollisionSolverTest, RestingPairResultIsReused) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::AABB, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 0.0f, 1.9f, 2.0f, 2.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    EXPECT_FALSE(solver.reusePair(0, 1));
+    solver.addPair(0, 1, true);
+    solver.solvePairs();
+    ASSERT_EQ(solver.collisions.size(), 1);
+    ASSERT_EQ(solver.pairResults.size(), 1);
+
+    solver.clear();
+    ASSERT_TRUE(solver.reusePair(1, 0));
+    ASSERT_EQ(solver.collisions.size(), 1);
+    EXPECT_EQ(solver.collisions[0].pointCount, 2);
+    EXPECT_NEAR(solver.collisions[0].normal.y, 1.0f, 1e-5f);
+    solver.solvePairs();
+    EXPECT_EQ(solver.pairResults.size(), 1);
+
+    // Results not reused or stored in a step are dropped.
+    solver.clear();
+    solver.solvePairs();
+    EXPECT_EQ(solver.pairResults.size(), 0);
+}
+
+// Polygons collide against boxes through their outlines, and against circles on faces and corners.
+TEST(CollisionSolverTest, PolygonCollidesWithBoxAndCircle) {
+    vector<int> intData;
+    vector<float> floatData;
+    // A triangle pointing up, its base at y = 1.
+    pushBox(intData, floatData, 1, ObjectShape::POLYGON, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 0.0f, 1.9f, 4.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 3, ObjectShape::CIRCLE, 0.0f, -1.4f, 0.5f, 0.5f, 0.0f);
+
+    vector<float> polygons;
+    ASSERT_GT(writePolygonRecord(polygons, 0, {-1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 1.0f}), 0.0f);
+    intData[LIVE_INT_SHAPE_DATA] = 0;
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes, polygons);
+    ASSERT_EQ(shapes[0].vertexCount, 3);
+
+    // Box-polygon is solved in that order, so the normal points from the box to the triangle.
+    CollisionSolver solver(intData, floatData, shapes);
+    ASSERT_TRUE(solver.solve(0, 1));
+    EXPECT_EQ(solver.collisions[0].indexA, 1);
+    EXPECT_EQ(solver.collisions[0].pointCount, 2);
+    EXPECT_NEAR(solver.collisions[0].normal.y, -1.0f, 1e-5f);
+    EXPECT_NEAR(solver.collisions[0].penetrationDepth, 0.1f, 1e-5f);
+
+    // The circle touches the apex of the triangle.
+    ASSERT_TRUE(solver.solve(2, 0));
+    const CollisionInfo& info = solver.collisions[1];
+    EXPECT_EQ(info.indexA, 2);
+    EXPECT_NEAR(info.normal.y, 1.0f, 1e-5f);
+    EXPECT_NEAR(info.penetrationDepth, 0.1f, 1e-5f);
+    EXPECT_NEAR(info.contactPoint.y, -1.0f, 1e-5f);
+
+    // Once moved clear of the apex, the circle misses.
+    floatData[2 * FDATA_EPO + FDATA_X] = 0.6f;
+    EXPECT_FALSE(solver.solve(2, 0));
+}
+
+// Only the child shapes that touch the other body produce collisions, each tagged with its child.
+TEST(CollisionSolverTest, CompoundCollidesPerChild) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::COMPOUND, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::CIRCLE, 3.0f, -1.4f, 0.5f, 0.5f, 0.0f);
+
+    // Two unit boxes side by side, two units apart, and a circle on top of the right one.
+    Compound compound;
+    ASSERT_TRUE(buildCompound({
+        static_cast<float>(ObjectShape::BOX), -1.0f, 0.0f, 0.0f, 2.0f, 2.0f, 1.0f,
+        static_cast<float>(ObjectShape::BOX), 3.0f, 0.0f, 0.0f, 2.0f, 2.0f, 1.0f,
+    }, compound));
+    EXPECT_NEAR(compound.centerOfMass.x, 1.0f, 1e-5f);
+    EXPECT_EQ(compound.nodes.size(), 3);
+
+    // The body sits at the children's center of mass.
+    floatData[FDATA_X] = 1.0f;
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    updateCompoundGeometry(compound, Vec2(1.0f, 0.0f), shapes[0].axisX);
+    shapes[0].compound = &compound;
+
+    CollisionSolver solver(intData, floatData, shapes);
+    ASSERT_TRUE(solver.solve(1, 0));
+    ASSERT_EQ(solver.collisions.size(), 1);
+
+    const CollisionInfo& info = solver.collisions[0];
+    EXPECT_EQ(info.indexA, 1);
+    EXPECT_EQ(info.childA, -1);
+    EXPECT_EQ(info.childB, 1);
+    EXPECT_NEAR(info.normal.y, 1.0f, 1e-5f);
+    EXPECT_NEAR(info.penetrationDepth, 0.1f, 1e-5f);
+
+    // Over the gap between the children, nothing touches.
+    floatData[1 * FDATA_EPO + FDATA_X] = 1.0f;
+    solver.clear();
+    EXPECT_FALSE(solver.solve(1, 0));
+}
+
+// Capsules lying on each other get two points, and a circle on the rounded end gets one.
+TEST(CollisionSolverTest, CapsuleSegmentContacts) {
+    vector<int> intData;
+    vector<float> floatData;
+    // Core segments from -1 to 1 along x, radius 0.5.
+    pushBox(intData, floatData, 1, ObjectShape::CAPSULE, 0.0f, 0.0f, 3.0f, 1.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::CAPSULE, 0.5f, 0.9f, 3.0f, 1.0f, 0.0f);
+    pushBox(intData, floatData, 3, ObjectShape::CIRCLE, 1.8f, 0.0f, 0.5f, 0.5f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+
+    ASSERT_TRUE(solver.solve(0, 1));
+    const CollisionInfo& stacked = solver.collisions[0];
+    EXPECT_NEAR(stacked.normal.y, 1.0f, 1e-5f);
+    ASSERT_EQ(stacked.pointCount, 2);
+    EXPECT_NEAR(stacked.points[0].penetrationDepth, 0.1f, 1e-5f);
+    EXPECT_NEAR(stacked.points[1].penetrationDepth, 0.1f, 1e-5f);
+    EXPECT_NEAR(min(stacked.points[0].point.x, stacked.points[1].point.x), -0.5f, 1e-5f);
+    EXPECT_NEAR(max(stacked.points[0].point.x, stacked.points[1].point.x), 1.0f, 1e-5f);
+
+    ASSERT_TRUE(solver.solve(2, 0));
+    const CollisionInfo& end = solver.collisions[1];
+    EXPECT_EQ(end.pointCount, 1);
+    EXPECT_NEAR(end.normal.x, -1.0f, 1e-5f);
+    EXPECT_NEAR(end.penetrationDepth, 0.2f, 1e-5f);
+
+    // Standing upright, the first capsule clears the circle.
+    floatData[FDATA_COS] = 0.0f;
+    floatData[FDATA_SIN] = 1.0f;
+    updateShapeCaches(intData, floatData, shapes);
+    solver.clear();
+    EXPECT_FALSE(solver.solve(2, 0));
+}
+
+// A capsule's end cap near a box's corner only touches it if the corner is within the radius, and
+// then gets one point along the line to the corner, not a face contact.
+TEST(CollisionSolverTest, CapsuleEndCapAgainstBoxCorner) {
+    vector<int> intData;
+    vector<float> floatData;
+    // Core segment from (0, 0) to (2, 0), radius 1.
+    pushBox(intData, floatData, 1, ObjectShape::CAPSULE, 1.0f, 0.0f, 4.0f, 2.0f, 0.0f);
+    // Lower left corner at (2.8, 0.8), about 0.13 beyond the end cap.
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 3.8f, 1.8f, 2.0f, 2.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    EXPECT_FALSE(solver.solve(0, 1));
+    EXPECT_FALSE(solver.solve(1, 0));
+    EXPECT_EQ(solver.collisions.size(), 0);
+
+    // Corner at (2.5, 0.5), inside the end cap.
+    floatData[FDATA_EPO + FDATA_X] = 3.5f;
+    floatData[FDATA_EPO + FDATA_Y] = 1.5f;
+    updateShapeCaches(intData, floatData, shapes);
+    ASSERT_TRUE(solver.solve(0, 1));
+    ASSERT_EQ(solver.collisions.size(), 1);
+
+    const CollisionInfo& info = solver.collisions[0];
+    ASSERT_EQ(info.pointCount, 1);
+    // From the capsule to the box.
+    Vec2 normal = info.indexA == 0 ? info.normal : -info.normal;
+    EXPECT_NEAR(normal.x, sqrt(0.5f), 1e-4f);
+    EXPECT_NEAR(normal.y, sqrt(0.5f), 1e-4f);
+    EXPECT_NEAR(info.points[0].penetrationDepth, 1.0f - sqrt(0.5f), 1e-4f);
+    // Halfway between the corner and the end cap's surface.
+    EXPECT_NEAR(info.points[0].point.x, (2.5f + 2.0f + sqrt(0.5f)) * 0.5f, 1e-4f);
+
+    // Lying along the box's bottom face, it still gets the two point face contact.
+    floatData[FDATA_EPO + FDATA_X] = 2.0f;
+    floatData[FDATA_EPO + FDATA_Y] = 1.9f;
+    updateShapeCaches(intData, floatData, shapes);
+    solver.clear();
+    ASSERT_TRUE(solver.solve(0, 1));
+    EXPECT_EQ(solver.collisions[0].pointCount, 2);
+    EXPECT_NEAR(solver.collisions[0].penetrationDepth, 0.1f, 1e-4f);
+}
+
+// Impulses stored on a manifold are carried over to points with the same feature id.
+TEST(CollisionSolverTest, ManifoldCarriesImpulsesBetweenSteps) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::AABB, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::BOX, 0.0f, 1.9f, 2.0f, 2.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    solver.solve(0, 1);
+    solver.updateManifolds();
+
+    ASSERT_EQ(solver.manifolds.size(), 1);
+    ContactManifold& manifold = solver.manifolds[makePairKey(1, 2)];
+    ASSERT_EQ(manifold.pointCount, 2);
+    manifold.points[0].normalImpulse = 3.0f;
+    manifold.points[1].normalImpulse = 4.0f;
+
+    // Next step, the box has settled slightly deeper.
+    floatData[1 * FDATA_EPO + FDATA_Y] = 1.89f;
+    updateShapeCaches(intData, floatData, shapes);
+    solver.clear();
+    solver.solve(0, 1);
+    solver.updateManifolds();
+
+    const CollisionInfo& info = solver.collisions[0];
+    ASSERT_EQ(info.pointCount, 2);
+    EXPECT_FLOAT_EQ(info.points[0].normalImpulse, 3.0f);
+    EXPECT_FLOAT_EQ(info.points[1].normalImpulse, 4.0f);
+    EXPECT_EQ(info.manifold, &manifold);
+
+    // Once the pair separates, the manifold is dropped.
+    floatData[1 * FDATA_EPO + FDATA_Y] = 5.0f;
+    updateShapeCaches(intData, floatData, shapes);
+    solver.clear();
+    solver.solve(0, 1);
+    solver.updateManifolds();
+    EXPECT_EQ(solver.manifolds.size(), 0);
+}
+
+// The reverse order of a supported pair is solved with the objects swapped.
+TEST(CollisionSolverTest, ReversedPairIsSwapped) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::CIRCLE, 0.0f, 1.4f, 0.5f, 0.5f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::AABB, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    ASSERT_TRUE(solver.solve(0, 1));
+    ASSERT_EQ(solver.collisions.size(), 1);
+
+    const CollisionInfo& info = solver.collisions[0];
+    EXPECT_EQ(info.indexA, 1);
+    EXPECT_EQ(info.indexB, 0);
+    EXPECT_NEAR(info.normal.y, 1.0f, 1e-5f);
+    EXPECT_NEAR(info.penetrationDepth, 0.1f, 1e-5f);
+}
+
+// Unsupported pairs are a no-op, in either order.
+TEST(CollisionSolverTest, UnsupportedPairIsIgnored) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushBox(intData, floatData, 1, ObjectShape::AABB, 0.0f, 0.0f, 2.0f, 2.0f, 0.0f);
+    pushBox(intData, floatData, 2, ObjectShape::POINT, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+    vector<ShapeCache> shapes;
+    updateShapeCaches(intData, floatData, shapes);
+    CollisionSolver solver(intData, floatData, shapes);
+    EXPECT_FALSE(solver.solve(0, 1));
+    EXPECT_FALSE(solver.solve(1, 0));
+    EXPECT_EQ(solver.collisions.size(), 0);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "allocation-counter.h"
+#include "frame-arena.h"
+#include "world.h"
+
+// Allocations bump through one block. A frame that runs past it gets extra blocks, and the next
+// reset grows the block to the high-water mark.
+TEST(FrameArenaTest, GrowsToHighWaterMark) {
+    FrameArena arena;
+    arena.reserve(64);
+    EXPECT_EQ(arena.capacity(), 4096);
+
+    void* a = arena.allocate(24, 8);
+    void* b = arena.allocate(8, 16);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0);
+    EXPECT_GE(static_cast<unsigned char*>(b), static_cast<unsigned char*>(a) + 24);
+
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0);
+    EXPECT_EQ(arena.allocate(24, 8), a);
+
+    arena.allocate(10000, 8);
+    EXPECT_GT(arena.highWaterMark(), 10000);
+    arena.reset();
+    EXPECT_GE(arena.capacity(), arena.highWaterMark());
+
+    // Now the same frame fits.
+    startCountingAllocations();
+    arena.allocate(24, 8);
+    arena.allocate(10000, 8);
+    arena.reset();
+    EXPECT_EQ(stopCountingAllocations(), 0);
+
+    FrameVector<int> numbers{FrameAllocator<int>(&arena)};
+    for (int i = 0; i < 100; i++) numbers.push_back(i);
+    EXPECT_EQ(numbers[99], 99);
+    resetFrameVector(numbers, &arena);
+    EXPECT_TRUE(numbers.empty());
+}
+
+// Once a scene has settled, stepping it allocates nothing.
+TEST(FrameArenaTest, SteadyStepsDontAllocate) {
+    World world;
+    world.setGravity(0.0f, 10.0f);
+
+    ObjectDesc floor;
+    floor.type = ObjectType::FIXED_OBJECT;
+    floor.shape = ObjectShape::AABB;
+    floor.x = 10.0f;
+    floor.y = 11.0f;
+    floor.width = 30.0f;
+    floor.height = 2.0f;
+    world.makeObject(1, floor);
+
+    // A row of boxes and circles resting on the floor, apart from each other.
+    for (int i = 0; i < 20; i++) {
+        ObjectDesc desc;
+        desc.shape = i % 2 ? ObjectShape::AABB : ObjectShape::CIRCLE;
+        desc.x = i * 1.2f;
+        desc.y = 9.5f;
+        desc.width = 1.0f;
+        desc.height = 1.0f;
+        desc.mass = 1.0f;
+        if (desc.shape == ObjectShape::CIRCLE) desc.width = 0.5f;
+        world.makeObject(i + 2, desc);
+    }
+
+    for (int i = 0; i < 120; i++) world.step();
+
+    startCountingAllocations();
+    for (int i = 0; i < 60; i++) world.step();
+    EXPECT_EQ(stopCountingAllocations(), 0);
+    EXPECT_EQ(world.eventIntData[0], 20);  // Still resting on the floor.
+}
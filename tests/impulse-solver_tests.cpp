@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "world.h"
+#include "impulse-solver.h"
+
+// Helper function to append an object record to raw live data.
+void pushSolverObject(vector<int>& intData, vector<float>& floatData, int id, ObjectType type, float x, float y, float vx, float vy, float mass) {
+    intData.insert(intData.end(), {id, static_cast<int>(ObjectShape::CIRCLE), static_cast<int>(type), 0, -1, DEFAULT_MATERIAL});
+
+    vector<float> data(FDATA_EPO, 0.0f);
+    data[FDATA_X] = x;
+    data[FDATA_Y] = y;
+    data[FDATA_VX] = vx;
+    data[FDATA_VY] = vy;
+    data[FDATA_COS] = 1.0f;
+    data[FDATA_M] = mass;
+    data[FDATA_IM] = mass > 0.0f ? 1.0f / mass : 0.0f;
+    floatData.insert(floatData.end(), data.begin(), data.end());
+}
+
+CollisionInfo makeContact(int indexA, int indexB, Vec2 contactPoint, Vec2 normal, float depth) {
+    CollisionInfo info{};
+    info.isColliding = true;
+    info.contactPoint = contactPoint;
+    info.normal = normal;
+    info.penetrationDepth = depth;
+    info.indexA = indexA;
+    info.indexB = indexB;
+    info.childA = -1;
+    info.childB = -1;
+    info.pointCount = 1;
+    info.points[0] = ContactPoint{contactPoint, depth, 0, 0.0f, 0.0f};
+    info.manifold = nullptr;
+    return info;
+}
+
+// Two equal bodies closing head on should stop along the normal with no restitution.
+TEST(ImpulseSolverTest, HeadOnContactStopsApproach) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushSolverObject(intData, floatData, 1, ObjectType::RIGID_BODY, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f);
+    pushSolverObject(intData, floatData, 2, ObjectType::RIGID_BODY, 1.5f, 0.0f, -1.0f, 0.0f, 1.0f);
+
+    FrameVector<CollisionInfo> collisions = {makeContact(0, 1, Vec2(0.75f, 0.0f), Vec2(1.0f, 0.0f), 0.5f)};
+
+    ImpulseSolver solver(intData, floatData);
+    solver.hasPenetrationResolution = false;
+    solver.hasRestitution = false;
+    solver.solve(collisions);
+
+    EXPECT_NEAR(floatData[0 * FDATA_EPO + FDATA_VX], 0.0f, 1e-5f);
+    EXPECT_NEAR(floatData[1 * FDATA_EPO + FDATA_VX], 0.0f, 1e-5f);
+    EXPECT_NEAR(collisions[0].normalImpulseMagnitude, 1.0f, 1e-5f);
+}
+
+// Separating bodies must not be pulled together.
+TEST(ImpulseSolverTest, SeparatingContactAppliesNoImpulse) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushSolverObject(intData, floatData, 1, ObjectType::RIGID_BODY, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f);
+    pushSolverObject(intData, floatData, 2, ObjectType::RIGID_BODY, 1.5f, 0.0f, 1.0f, 0.0f, 1.0f);
+
+    FrameVector<CollisionInfo> collisions = {makeContact(0, 1, Vec2(0.75f, 0.0f), Vec2(1.0f, 0.0f), 0.5f)};
+
+    ImpulseSolver solver(intData, floatData);
+    solver.hasPenetrationResolution = false;
+    solver.solve(collisions);
+
+    EXPECT_FLOAT_EQ(floatData[0 * FDATA_EPO + FDATA_VX], -1.0f);
+    EXPECT_FLOAT_EQ(floatData[1 * FDATA_EPO + FDATA_VX], 1.0f);
+    EXPECT_FLOAT_EQ(collisions[0].normalImpulseMagnitude, 0.0f);
+}
+
+// A resting contact is warm started from the impulse accumulated on its contact point.
+TEST(ImpulseSolverTest, WarmStartsFromCachedImpulse) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushSolverObject(intData, floatData, 1, ObjectType::FIXED_OBJECT, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+    pushSolverObject(intData, floatData, 2, ObjectType::RIGID_BODY, 0.0f, 0.0f, 0.0f, 0.5f, 2.0f);
+
+    // The body moves down into the ground (normal points from the ground to the body).
+    FrameVector<CollisionInfo> collisions = {makeContact(0, 1, Vec2(0.0f, 0.5f), Vec2(0.0f, -1.0f), 0.01f)};
+
+    ImpulseSolver solver(intData, floatData);
+    solver.hasPenetrationResolution = false;
+    solver.solve(collisions);
+
+    EXPECT_NEAR(collisions[0].points[0].normalImpulse, 1.0f, 1e-5f);
+
+    // Same approach speed again. Warm starting alone should resolve it.
+    floatData[1 * FDATA_EPO + FDATA_VY] = 0.5f;
+    solver.velocityIterations = 0;
+    solver.solve(collisions);
+
+    EXPECT_NEAR(floatData[1 * FDATA_EPO + FDATA_VY], 0.0f, 1e-5f);
+}
+
+// A body dropped on fixed ground comes to rest instead of jittering.
+TEST(ImpulseSolverTest, BodySettlesOnGround) {
+    World world;
+    world.setGravity(0.0f, 10.0f);
+
+    MockVal fixedOptions;
+    fixedOptions.properties["type"] = static_cast<int>(ObjectType::FIXED_OBJECT);
+    world.makeObject(1, fixedOptions);
+    PhysicalObject* ground = world.getObject(1);
+    ground->shape = ObjectShape::AABB;
+    world.liveIntData[ground->worldIndex * LIVE_INT_EPO + LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::AABB);
+    world.liveFloatData[ground->worldIndex * FDATA_EPO + FDATA_W] = 10.0f;
+    world.liveFloatData[ground->worldIndex * FDATA_EPO + FDATA_H] = 1.0f;
+    ground->setPosition(Vec2(1.0f, 5.5f));
+
+    MockVal bodyOptions;
+    bodyOptions.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(2, bodyOptions);
+    PhysicalObject* body = world.getObject(2);
+    world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_RADIUS] = 0.5f;
+    body->setMass(1.0f);
+    body->setPosition(Vec2(1.0f, 4.0f));
+
+    for(int i = 0; i < 240; i++) world.step();
+
+    EXPECT_NEAR(body->getVelocityY(), 0.0f, 0.05f);
+    EXPECT_NEAR(body->getY(), 4.5f, 0.05f);
+}
+
+// Constraints of one batch never share a dynamic body.
+TEST(ImpulseSolverTest, ColoredBatchesShareNoDynamicBody) {
+    vector<int> intData;
+    vector<float> floatData;
+    pushSolverObject(intData, floatData, 0, ObjectType::FIXED_OBJECT, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+    // A row of bodies resting on the ground and touching their neighbours.
+    FrameVector<CollisionInfo> collisions;
+    int bodyCount = 200;
+    for(int i = 1; i <= bodyCount; i++){
+        pushSolverObject(intData, floatData, i, ObjectType::RIGID_BODY, i * 1.0f, -1.0f, 0.0f, 0.1f, 1.0f);
+        collisions.push_back(makeContact(0, i, Vec2(i * 1.0f, -0.5f), Vec2(0.0f, -1.0f), 0.01f));
+        if(i > 1) collisions.push_back(makeContact(i - 1, i, Vec2(i - 0.5f, -1.0f), Vec2(1.0f, 0.0f), 0.01f));
+    }
+
+    ImpulseSolver solver(intData, floatData);
+    solver.workerPool.setThreadCount(4);
+    solver.solve(collisions);
+
+    ASSERT_GT(solver.batchOffsets.size(), 2);
+    EXPECT_EQ(solver.batchOffsets.back(), static_cast<int>(solver.constraints.size()));
+
+    for(size_t b = 0; b + 1 < solver.batchOffsets.size(); b++){
+        vector<int> seen(bodyCount + 1, 0);
+        for(int i = solver.batchOffsets[b]; i < solver.batchOffsets[b + 1]; i++){
+            const ContactConstraint& c = solver.constraints[i];
+            if(c.invMassA != 0.0f){
+                EXPECT_EQ(seen[c.indexA]++, 0);
+            }
+            if(c.invMassB != 0.0f){
+                EXPECT_EQ(seen[c.indexB]++, 0);
+            }
+        }
+    }
+
+    // Every body ends up resting on the ground.
+    for(int i = 1; i <= bodyCount; i++){
+        EXPECT_NEAR(floatData[i * FDATA_EPO + FDATA_VY], 0.0f, 1e-3f);
+    }
+}
+
+// At a 20 Hz step rate, substepping keeps a dropped body from sinking or bouncing off the ground.
+TEST(ImpulseSolverTest, SubstepsSettleAtLowStepRate) {
+    World world;
+    world.setGravity(0.0f, 10.0f);
+    world.setTimeStep(1.0f / 20.0f);
+    world.setSubsteps(4);
+
+    MockVal fixedOptions;
+    fixedOptions.properties["type"] = static_cast<int>(ObjectType::FIXED_OBJECT);
+    world.makeObject(1, fixedOptions);
+    PhysicalObject* ground = world.getObject(1);
+    ground->shape = ObjectShape::AABB;
+    world.liveIntData[ground->worldIndex * LIVE_INT_EPO + LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::AABB);
+    world.liveFloatData[ground->worldIndex * FDATA_EPO + FDATA_W] = 10.0f;
+    world.liveFloatData[ground->worldIndex * FDATA_EPO + FDATA_H] = 1.0f;
+    ground->setPosition(Vec2(1.0f, 5.5f));
+
+    MockVal bodyOptions;
+    bodyOptions.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(2, bodyOptions);
+    PhysicalObject* body = world.getObject(2);
+    world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_RADIUS] = 0.5f;
+    body->setMass(1.0f);
+    body->setPosition(Vec2(1.0f, 3.0f));
+
+    for(int i = 0; i < 80; i++) world.step();
+
+    EXPECT_NEAR(body->getVelocityY(), 0.0f, 0.05f);
+    EXPECT_NEAR(body->getY(), 4.5f, 0.05f);
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "material-table.h"
+#include "world.h"
+
+// Pairs combine to the larger restitution and the smaller frictions, and stay right as the table
+// grows and materials change.
+TEST(MaterialTableTest, PairsAreCombined) {
+    MaterialTable table;
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_FLOAT_EQ(table.pair(DEFAULT_MATERIAL, TERRAIN_MATERIAL).restitution, 0.2f);
+
+    int ice = table.add(Material{0.1f, 0.05f, 0.02f, 0.0f, 0.0f});
+    int rubber = table.add(Material{0.9f, 1.2f, 1.0f, 0.1f, 0.1f});
+    EXPECT_FLOAT_EQ(table.pair(ice, rubber).restitution, 0.9f);
+    EXPECT_FLOAT_EQ(table.pair(rubber, ice).staticFriction, 0.05f);
+    EXPECT_FLOAT_EQ(table.pair(ice, DEFAULT_MATERIAL).kineticFriction, 0.02f);
+
+    // Past the first rows of the table.
+    for (int i = 0; i < 20; i++) table.add(Material{0.01f * i, 2.0f, 2.0f, 0.0f, 0.0f});
+    EXPECT_FLOAT_EQ(table.pair(ice, rubber).restitution, 0.9f);
+    EXPECT_FLOAT_EQ(table.pair(rubber, table.size() - 1).staticFriction, 1.2f);
+
+    ASSERT_TRUE(table.set(ice, Material{0.95f, 0.05f, 0.02f, 0.0f, 0.0f}));
+    EXPECT_FLOAT_EQ(table.pair(rubber, ice).restitution, 0.95f);
+    EXPECT_FALSE(table.set(table.size(), Material()));
+
+    // Interning finds equal materials, but never hands out the terrain's.
+    EXPECT_EQ(table.intern(Material()), DEFAULT_MATERIAL);
+    EXPECT_EQ(table.intern(Material{0.9f, 1.2f, 1.0f, 0.1f, 0.1f}), rubber);
+    EXPECT_NE(table.intern(table.get(TERRAIN_MATERIAL)), TERRAIN_MATERIAL);
+
+    while (table.size() < MAX_MATERIALS) table.add(Material());
+    EXPECT_EQ(table.add(Material()), -1);
+}
+
+// Objects made with the same coefficients share a material. Changing one object's coefficients
+// moves it to another material, and changing a material changes every object using it.
+TEST(MaterialTableTest, ObjectsShareMaterials) {
+    World world;
+
+    ObjectDesc desc;
+    desc.restitution = 0.5f;
+    world.makeObject(1, desc);
+    world.makeObject(2, desc);
+    PhysicalObject* a = world.getObject(1);
+    PhysicalObject* b = world.getObject(2);
+    EXPECT_EQ(a->getMaterial(), b->getMaterial());
+    EXPECT_FLOAT_EQ(b->getRestitution(), 0.5f);
+
+    a->setKineticFriction(0.3f);
+    EXPECT_NE(a->getMaterial(), b->getMaterial());
+    EXPECT_FLOAT_EQ(a->getRestitution(), 0.5f);
+    EXPECT_FLOAT_EQ(b->getKineticFriction(), 1.0f);
+
+    int bouncy = world.addMaterial(1.0f, 0.5f, 0.5f, 0.0f, 0.0f);
+    desc.material = bouncy;
+    world.makeObject(3, desc);
+    EXPECT_EQ(world.getObject(3)->getMaterial(), bouncy);
+    EXPECT_TRUE(world.setObjectMaterial(2, bouncy));
+    EXPECT_FALSE(world.setObjectMaterial(2, world.materials.size()));
+
+    ASSERT_TRUE(world.setMaterial(bouncy, 0.7f, 0.5f, 0.5f, 0.0f, 0.0f));
+    EXPECT_FLOAT_EQ(b->getRestitution(), 0.7f);
+    EXPECT_FLOAT_EQ(world.getObject(3)->getRestitution(), 0.7f);
+}
+
+// Materials interned for objects' coefficients go away with their last object and their ids are
+// reused, so objects changing coefficients over and over don't fill the table.
+TEST(MaterialTableTest, InternedMaterialsAreReclaimed) {
+    World world;
+
+    ObjectDesc desc;
+    desc.restitution = 0.5f;
+    world.makeObject(1, desc);
+    world.makeObject(2, desc);
+    int shared = world.getObject(1)->getMaterial();
+    EXPECT_EQ(world.materials.refCount(shared), 2);
+
+    PhysicalObject* a = world.getObject(1);
+    for (int i = 0; i < 1000; i++) ASSERT_TRUE(a->setRestitution(0.001f * i));
+    EXPECT_LT(world.materials.size(), 8);
+    EXPECT_EQ(world.materials.refCount(shared), 1);
+
+    world.removeObject(2);
+    EXPECT_FALSE(world.materials.contains(shared));
+    EXPECT_FALSE(world.setObjectMaterial(1, shared));
+
+    // Materials from addMaterial and the built-in ones stay without objects.
+    int kept = world.addMaterial(0.3f, 0.5f, 0.5f, 0.0f, 0.0f);
+    desc.material = kept;
+    world.makeObject(3, desc);
+    world.removeObject(3);
+    world.removeObject(1);
+    EXPECT_TRUE(world.materials.contains(kept));
+    EXPECT_TRUE(world.materials.contains(DEFAULT_MATERIAL));
+    EXPECT_EQ(world.materials.intern(Material{0.3f, 0.5f, 0.5f, 0.0f, 0.0f}), kept);
+}
+
+// With the table full, setting coefficients no material has fails and changes nothing, and
+// making an object with them, or with a missing material, fails instead of using another.
+TEST(MaterialTableTest, FullTableIsReported) {
+    World world;
+    ObjectDesc desc;
+    ASSERT_NE(world.makeObject(1, desc), INVALID_HANDLE);
+    PhysicalObject* object = world.getObject(1);
+
+    while (world.addMaterial(0.5f, 0.5f, 0.5f, 0.0f, 0.0f) >= 0) {}
+    EXPECT_FALSE(object->setRestitution(0.9f));
+    EXPECT_FLOAT_EQ(object->getRestitution(), 0.2f);
+    EXPECT_EQ(object->getMaterial(), DEFAULT_MATERIAL);
+
+    desc.restitution = 0.9f;
+    EXPECT_EQ(world.makeObject(2, desc), INVALID_HANDLE);
+    desc.material = MAX_MATERIALS;
+    EXPECT_EQ(world.makeObject(3, desc), INVALID_HANDLE);
+    EXPECT_EQ(world.getObjectCount(), 1);
+
+    // Equal coefficients still share a material that's there.
+    desc.material = -1;
+    desc.restitution = 0.2f;
+    EXPECT_NE(world.makeObject(4, desc), INVALID_HANDLE);
+
+    world.setStagingCapacity(2);
+    world.stagingIntData[LIVE_INT_MATERIAL] = DEFAULT_MATERIAL;
+    world.stagingIntData[LIVE_INT_EPO + LIVE_INT_MATERIAL] = -1;
+    EXPECT_EQ(world.makeObjects(2), 0);
+    EXPECT_EQ(world.getObjectCount(), 2);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "slot-map.h"
+
+// A removed slot is reused under a new generation, and the old handle stops resolving.
+TEST(SlotMapTest, StaleHandlesDontResolve) {
+    SlotMap<int> map;
+    uint32_t a = map.insert(10);
+    uint32_t b = map.insert(20);
+    EXPECT_NE(a, INVALID_HANDLE);
+    EXPECT_EQ(*map.get(b), 20);
+    EXPECT_EQ(map.get(INVALID_HANDLE), nullptr);
+
+    EXPECT_TRUE(map.remove(a));
+    EXPECT_FALSE(map.remove(a));
+    EXPECT_EQ(map.get(a), nullptr);
+
+    uint32_t c = map.insert(30);
+    EXPECT_EQ(SlotMap<int>::slotOf(c), SlotMap<int>::slotOf(a));
+    EXPECT_NE(c, a);
+    EXPECT_EQ(map.get(a), nullptr);
+    EXPECT_EQ(*map.get(c), 30);
+    EXPECT_EQ(map.size(), 2);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_EQ(map.get(b), nullptr);
+    EXPECT_EQ(map.get(c), nullptr);
+}
+
+// Once a slot has handed out every generation it is retired rather than wrapping, so a stale
+// handle can't come to resolve to a later value.
+TEST(SlotMapTest, SlotIsRetiredBeforeGenerationWraps) {
+    SlotMap<int> map;
+    uint32_t first = map.insert(1);
+    size_t available = map.available();
+
+    uint32_t handle = first;
+    for (uint32_t generation = 1; generation < SLOT_MAP_GENERATION_MASK; generation++) {
+        map.remove(handle);
+        handle = map.insert(2);
+        ASSERT_EQ(SlotMap<int>::slotOf(handle), SlotMap<int>::slotOf(first));
+    }
+    EXPECT_EQ(handle >> SLOT_MAP_INDEX_BITS, SLOT_MAP_GENERATION_MASK);
+    EXPECT_EQ(map.available(), available);
+
+    map.remove(handle);
+    EXPECT_EQ(map.available(), available);
+    uint32_t next = map.insert(3);
+    EXPECT_NE(SlotMap<int>::slotOf(next), SlotMap<int>::slotOf(first));
+    EXPECT_EQ(map.get(first), nullptr);
+    EXPECT_EQ(map.get(handle), nullptr);
+    EXPECT_EQ(*map.get(next), 3);
+}
+
+// A full map refuses inserts.
+TEST(SlotMapTest, FullMapReturnsInvalidHandle) {
+    SlotMap<int> map;
+    for (size_t i = 0; i <= SLOT_MAP_INDEX_MASK; i++) ASSERT_NE(map.insert(1), INVALID_HANDLE);
+    EXPECT_EQ(map.available(), 0);
+    EXPECT_EQ(map.insert(1), INVALID_HANDLE);
+    EXPECT_EQ(map.size(), SLOT_MAP_INDEX_MASK + 1);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "world.h"
+#include "tilemap.h"
+
+// Runs of solid tiles merge into rectangles, and a query reports each rectangle once.
+TEST(TilemapTest, MergesTilesIntoRectangles) {
+    Tilemap tilemap;
+    EXPECT_FALSE(tilemap.set(4, 3, 1.0f, Vec2(), {1, 1}));
+
+    ASSERT_TRUE(tilemap.set(4, 3, 2.0f, Vec2(10.0f, 0.0f), {
+        1, 1, 0, 0,
+        1, 1, 0, 1,
+        1, 1, 1, 1,
+    }));
+    ASSERT_EQ(tilemap.rects.size(), 3);
+    EXPECT_EQ(tilemap.rects[0].rows, 2);
+    EXPECT_EQ(tilemap.rects[0].columns, 2);
+    EXPECT_FLOAT_EQ(tilemap.rects[0].bounds.max.x, 14.0f);
+    EXPECT_EQ(tilemap.rects[2].columns, 4);
+    EXPECT_TRUE(tilemap.isSolidAt(Vec2(17.0f, 3.0f)));
+    EXPECT_FALSE(tilemap.isSolidAt(Vec2(15.0f, 3.0f)));
+
+    vector<int> found;
+    tilemap.query(Aabb(Vec2(9.0f, -1.0f), Vec2(19.0f, 7.0f)), [&](int rect) { found.push_back(rect); });
+    EXPECT_EQ(found.size(), 3);
+}
+
+// A circle rolling along a wall made of several rectangles crosses their seams without a bump,
+// and the tiles never become objects.
+TEST(TilemapTest, BodySlidesAcrossSeams) {
+    World world;
+    world.setGravity(10.0f, 0.0f);
+
+    // The wall's face at x = 10 is split into three rectangles, at y = 5 and y = 10.
+    vector<int> tiles(20 * 20, 0);
+    for (int row = 0; row < 20; row++) {
+        for (int column = 10; column < 20; column++) tiles[row * 20 + column] = column < 15 || (row >= 5 && row < 10);
+    }
+    ASSERT_TRUE(world.setTilemap(20, 20, 1.0f, 0.0f, 0.0f, tiles));
+    ASSERT_EQ(world.tilemap.rects.size(), 3);
+    world.setTerrainMaterial(0.0f, 0.0f, 0.0f);
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    PhysicalObject* body = world.getObject(1);
+    world.liveFloatData[FDATA_RADIUS] = 0.5f;
+    body->setMass(1.0f);
+    body->setDamping(0.0f);
+    body->setStaticFriction(0.0f);
+    body->setKineticFriction(0.0f);
+    body->setPosition(Vec2(9.5f, 1.0f));
+    body->setVelocity(Vec2(0.0f, 5.0f));
+
+    for (int i = 0; i < 120; i++) {
+        world.step();
+        EXPECT_NEAR(body->getVelocityX(), 0.0f, 0.01f);
+    }
+
+    EXPECT_NEAR(body->getVelocityY(), 5.0f, 0.01f);
+    EXPECT_GT(body->getY(), 10.0f);
+    EXPECT_NEAR(body->getX(), 9.5f, 0.02f);
+    EXPECT_EQ(world.getObjectCount(), 1);
+}
+
+// Changing the terrain only drops contacts with the terrain. A body still touching it carries on,
+// one that no longer does gets an end event, and contacts between objects are left alone.
+TEST(TilemapTest, SetTilemapKeepsObjectContacts) {
+    World world;
+    world.setGravity(0.0f, 10.0f);
+
+    vector<int> tiles(10 * 10, 0);
+    for (int column = 0; column < 10; column++) tiles[9 * 10 + column] = 1;
+    ASSERT_TRUE(world.setTilemap(10, 10, 1.0f, 0.0f, 0.0f, tiles));
+
+    // Two circles stacked on the floor.
+    ObjectDesc desc;
+    desc.mass = 1.0f;
+    desc.width = 0.5f;
+    desc.x = 5.0f;
+    desc.y = 8.5f;
+    world.makeObject(1, desc);
+    desc.y = 7.5f;
+    world.makeObject(2, desc);
+    for (int i = 0; i < 120; i++) world.step();
+
+    auto eventsOf = [&](int type) {
+        vector<pair<int, int>> pairs;
+        for (int e = 0; e < world.eventIntData[0]; e++) {
+            const int* event = &world.eventIntData[EVENT_HEADER + e * EVENT_INT_EPO];
+            if (event[EVENT_TYPE] == type) pairs.push_back({event[EVENT_ID_A], event[EVENT_ID_B]});
+        }
+        return pairs;
+    };
+
+    ASSERT_TRUE(world.setTilemap(10, 10, 1.0f, 0.0f, 0.0f, tiles));
+    world.step();
+    EXPECT_TRUE(eventsOf(static_cast<int>(CollisionEventType::BEGIN)).empty());
+    EXPECT_TRUE(eventsOf(static_cast<int>(CollisionEventType::END)).empty());
+    EXPECT_EQ(eventsOf(static_cast<int>(CollisionEventType::PERSIST)).size(), 2);
+
+    ASSERT_TRUE(world.setTilemap(10, 10, 1.0f, 0.0f, 0.0f, vector<int>(10 * 10, 0)));
+    world.step();
+    vector<pair<int, int>> ended = eventsOf(static_cast<int>(CollisionEventType::END));
+    ASSERT_EQ(ended.size(), 1);
+    EXPECT_EQ(ended[0], make_pair(1, TERRAIN_ID));
+    EXPECT_EQ(eventsOf(static_cast<int>(CollisionEventType::PERSIST)).size(), 1);
+}
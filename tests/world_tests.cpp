@@ -0,0 +1,553 @@
+#include <gtest/gtest.h>
+#include "allocation-counter.h"
+#include "world.h"
+
+// advance runs whole steps only and blends the remainder into the render transforms.
+TEST(WorldTest, AdvanceInterpolatesBetweenSteps) {
+    World world;
+    world.setGravity(0.0f, 0.0f);
+    world.setTimeStep(0.25f);
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    PhysicalObject* body = world.getObject(1);
+    body->setMass(1.0f);
+    body->setDamping(0.0f);
+    body->setVelocity(Vec2(4.0f, 0.0f));
+
+    // One and a half steps: one full step of one unit, then halfway to the next.
+    EXPECT_EQ(world.advance(0.375f, 5), 1);
+    EXPECT_NEAR(body->getX(), 1.0f, 1e-4f);
+    EXPECT_NEAR(world.getInterpolationAlpha(), 0.5f, 1e-3f);
+    EXPECT_NEAR(world.renderData[RENDER_X], 0.5f, 1e-3f);
+
+    // The leftover half step carries over.
+    EXPECT_EQ(world.advance(0.125f, 5), 1);
+    EXPECT_NEAR(body->getX(), 2.0f, 1e-4f);
+    EXPECT_NEAR(world.renderData[RENDER_X], 1.0f, 1e-3f);
+}
+
+// A long stall is capped at maxSubsteps and the backlog is dropped.
+TEST(WorldTest, AdvanceCapsSubsteps) {
+    World world;
+
+    EXPECT_EQ(world.advance(1.0f, 3), 3);
+    EXPECT_LT(world.getInterpolationAlpha(), 1.0f);
+    EXPECT_EQ(world.advance(0.0f, 3), 0);
+}
+
+// The integrated cos/sin pair follows the angle, and picks up angles written from outside.
+TEST(WorldTest, RotationStaysInSyncWithAngle) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    PhysicalObject* body = world.getObject(1);
+    body->shape = ObjectShape::BOX;
+    body->setMass(1.0f);
+    body->setRotationalDamping(0.0f);
+    world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_RS] = 3.0f;
+
+    for(int i = 0; i < 600; i++) world.step();
+
+    float r = body->getRotation();
+    EXPECT_NEAR(r, 30.0f, 1e-3f);
+    // The float angle itself accumulates rounding error at this magnitude.
+    EXPECT_NEAR(world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_COS], cos(r), 1e-3f);
+    EXPECT_NEAR(world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_SIN], sin(r), 1e-3f);
+
+    world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_R] = 1.0f;
+    world.step();
+
+    r = body->getRotation();
+    EXPECT_NEAR(world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_COS], cos(r), 1e-5f);
+    EXPECT_NEAR(world.liveFloatData[body->worldIndex * FDATA_EPO + FDATA_SIN], sin(r), 1e-5f);
+}
+
+// Objects that can't move are never tested against each other.
+TEST(WorldTest, FixedPairsAreSkipped) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::FIXED_OBJECT);
+    world.makeObject(1, options);
+    world.makeObject(2, options);
+    world.liveFloatData[0 * FDATA_EPO + FDATA_RADIUS] = 1.0f;
+    world.liveFloatData[1 * FDATA_EPO + FDATA_RADIUS] = 1.0f;
+    world.getObject(1)->setPosition(Vec2(0.0f, 0.0f));
+    world.getObject(2)->setPosition(Vec2(0.5f, 0.0f));
+
+    world.step();
+
+    EXPECT_EQ(world.liveIntData[0 * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION], 0);
+    EXPECT_EQ(world.liveIntData[1 * LIVE_INT_EPO + LIVE_INT_HAS_COLLISION], 0);
+}
+
+// Polygon records are validated, and the record of a removed object is reused.
+TEST(WorldTest, SetPolygonValidatesAndReusesRecords) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    world.makeObject(2, options);
+
+    // Not convex.
+    EXPECT_FALSE(world.setPolygon(1, {0.0f, 0.0f, 2.0f, 0.0f, 1.0f, 0.5f, 2.0f, 2.0f, 0.0f, 2.0f}));
+    EXPECT_EQ(world.liveIntData[0 * LIVE_INT_EPO + LIVE_INT_SHAPE_DATA], -1);
+
+    // Clockwise input is accepted and rewound.
+    ASSERT_TRUE(world.setPolygon(1, {-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f}));
+    EXPECT_EQ(world.getObject(1)->shape, ObjectShape::POLYGON);
+    EXPECT_NEAR(world.getObject(1)->getRadius(), sqrt(2.0f), 1e-5f);
+    EXPECT_NEAR(world.getObject(1)->aabb.max.x - world.getObject(1)->aabb.min.x, 2.0f, 0.5f);
+    const ShapeCache& cache = world.shapeCache[0];
+    for(int i = 0; i < cache.vertexCount; i++){
+        EXPECT_GT(cache.normals[i].dot(cache.vertices[i] - world.getObject(1)->getPosition()), 0.0f);
+    }
+
+    world.removeObject(1);
+    ASSERT_TRUE(world.setPolygon(2, {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f}));
+    EXPECT_EQ(world.liveIntData[world.getObject(2)->worldIndex * LIVE_INT_EPO + LIVE_INT_SHAPE_DATA], 0);
+    EXPECT_EQ(world.polygonData.size(), POLYGON_RECORD_SIZE);
+}
+
+// A compound takes its children's total mass and is centered on their center of mass, without
+// moving them.
+TEST(WorldTest, SetCompoundAggregatesMass) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    PhysicalObject* body = world.getObject(1);
+    body->setPosition(Vec2(10.0f, 10.0f));
+
+    ASSERT_TRUE(world.setCompound(1, {
+        static_cast<float>(ObjectShape::CIRCLE), 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+        static_cast<float>(ObjectShape::BOX), 4.0f, 0.0f, 0.0f, 2.0f, 2.0f, 3.0f,
+    }));
+    EXPECT_EQ(body->shape, ObjectShape::COMPOUND);
+    EXPECT_FLOAT_EQ(body->getMass(), 4.0f);
+    EXPECT_NEAR(body->getX(), 13.0f, 1e-5f);
+    EXPECT_NEAR(body->aabb.min.x, 9.0f, 0.5f);
+    EXPECT_NEAR(body->aabb.max.x, 15.0f, 0.5f);
+
+    // Only circles and boxes can be children.
+    EXPECT_FALSE(world.setCompound(1, {static_cast<float>(ObjectShape::POINT), 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f}));
+}
+
+// A capsule's bounds follow its rotation.
+TEST(WorldTest, CapsuleBoundsFollowRotation) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    PhysicalObject* body = world.getObject(1);
+    body->shape = ObjectShape::CAPSULE;
+    world.liveIntData[LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::CAPSULE);
+    world.liveFloatData[FDATA_W] = 4.0f;
+    world.liveFloatData[FDATA_H] = 1.0f;
+    body->setRotation(3.14159265f / 2.0f);
+
+    updateShapeCache(world.liveIntData, world.liveFloatData, 0, world.shapeCache[0]);
+    body->recomputeAabb(true);
+
+    EXPECT_NEAR(body->aabb.min.x, -0.5f, 1e-5f);
+    EXPECT_NEAR(body->aabb.max.x, 0.5f, 1e-5f);
+    EXPECT_NEAR(body->aabb.min.y, -2.0f, 1e-5f);
+    EXPECT_NEAR(body->aabb.max.y, 2.0f, 1e-5f);
+}
+
+// A contact reports begin, then persist while it lasts, then end once.
+TEST(WorldTest, CollisionEventsFollowContact) {
+    World world;
+    world.setHasPenetrationResolution(false);
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(1, options);
+    world.makeObject(2, options);
+    for(int i = 0; i < 2; i++){
+        world.liveFloatData[i * FDATA_EPO + FDATA_RADIUS] = 0.5f;
+        world.getObject(i + 1)->setMass(1.0f);
+        world.getObject(i + 1)->setDamping(0.0f);
+    }
+    world.getObject(1)->setPosition(Vec2(1.0f, 1.0f));
+    world.getObject(2)->setPosition(Vec2(1.9f, 1.0f));
+    world.getObject(2)->setVelocity(Vec2(3.0f, 0.0f));
+
+    vector<int> types;
+    for(int i = 0; i < 10; i++){
+        world.step();
+        ASSERT_EQ(world.eventIntData[0] * EVENT_INT_EPO + EVENT_HEADER, static_cast<int>(world.eventIntData.size()));
+        ASSERT_EQ(world.eventIntData[0] * EVENT_FLOAT_EPO, static_cast<int>(world.eventFloatData.size()));
+        for(int e = 0; e < world.eventIntData[0]; e++){
+            const int* event = &world.eventIntData[EVENT_HEADER + e * EVENT_INT_EPO];
+            EXPECT_EQ(min(event[EVENT_ID_A], event[EVENT_ID_B]), 1);
+            EXPECT_EQ(max(event[EVENT_ID_A], event[EVENT_ID_B]), 2);
+            types.push_back(event[EVENT_TYPE]);
+        }
+    }
+
+    vector<int> expected = {
+        static_cast<int>(CollisionEventType::BEGIN),
+        static_cast<int>(CollisionEventType::PERSIST),
+        static_cast<int>(CollisionEventType::END),
+    };
+    EXPECT_EQ(types, expected);
+}
+
+// With substeps, a body moved and a body rotated from outside are collided at their new pose in
+// the very next step.
+TEST(WorldTest, SubstepsCollideTeleportedBodies) {
+    World world;
+    world.setSubsteps(4);
+
+    ObjectDesc desc;
+    desc.mass = 1.0f;
+    desc.width = 0.5f;
+    world.makeObject(1, desc);
+
+    // A thin bar lying flat, away from the circle.
+    desc.shape = ObjectShape::BOX;
+    desc.x = 10.0f;
+    desc.width = 4.0f;
+    desc.height = 0.4f;
+    world.makeObject(2, desc);
+
+    for (int i = 0; i < 5; i++) world.step();
+    EXPECT_EQ(world.eventIntData[0], 0);
+
+    // Stood on end, the bar reaches the circle's new position. Flat, it wouldn't.
+    world.getObject(1)->setPosition(Vec2(10.0f, 1.5f));
+    world.getObject(2)->setRotation(1.5707964f);
+    world.step();
+
+    ASSERT_EQ(world.eventIntData[0], 1);
+    const int* event = &world.eventIntData[EVENT_HEADER];
+    EXPECT_EQ(event[EVENT_TYPE], static_cast<int>(CollisionEventType::BEGIN));
+    EXPECT_EQ(min(event[EVENT_ID_A], event[EVENT_ID_B]), 1);
+    EXPECT_EQ(max(event[EVENT_ID_A], event[EVENT_ID_B]), 2);
+}
+
+// A body passing through a sensor enters and exits it once, and is not pushed by it.
+TEST(WorldTest, SensorReportsEnterAndExit) {
+    World world;
+
+    MockVal sensorOptions;
+    sensorOptions.properties["type"] = static_cast<int>(ObjectType::SENSOR);
+    world.makeObject(1, sensorOptions);
+    world.liveFloatData[0 * FDATA_EPO + FDATA_RADIUS] = 1.0f;
+    world.getObject(1)->setPosition(Vec2(5.0f, 1.0f));
+
+    MockVal bodyOptions;
+    bodyOptions.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    world.makeObject(2, bodyOptions);
+    PhysicalObject* body = world.getObject(2);
+    world.liveFloatData[1 * FDATA_EPO + FDATA_RADIUS] = 0.5f;
+    body->setMass(1.0f);
+    body->setDamping(0.0f);
+    body->setPosition(Vec2(1.0f, 1.0f));
+    body->setVelocity(Vec2(6.0f, 0.0f));
+
+    int enters = 0;
+    int exits = 0;
+    bool overlapped = false;
+    for(int i = 0; i < 90; i++){
+        world.step();
+        enters += world.sensorEnterData[0];
+        exits += world.sensorExitData[0];
+        if(world.sensorEnterData[0] > 0){
+            EXPECT_EQ(world.sensorEnterData[SENSOR_EVENT_HEADER + SENSOR_EVENT_SENSOR_ID], 1);
+            EXPECT_EQ(world.sensorEnterData[SENSOR_EVENT_HEADER + SENSOR_EVENT_OTHER_ID], 2);
+        }
+        overlapped |= world.getSensorOverlaps(1) == vector<int>{2};
+    }
+
+    EXPECT_EQ(enters, 1);
+    EXPECT_EQ(exits, 1);
+    EXPECT_TRUE(overlapped);
+    EXPECT_TRUE(world.getSensorOverlaps(1).empty());
+    EXPECT_FLOAT_EQ(body->getVelocityX(), 6.0f);
+}
+
+// Removal leaves a hole until the next step, which moves the last record into it and updates the
+// slot table.
+TEST(WorldTest, RemovalIsCompactedOnStep) {
+    World world;
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+    uint32_t handles[4];
+    for(int i = 0; i < 4; i++) handles[i] = world.makeObject(i + 1, options);
+
+    EXPECT_TRUE(world.removeObject(1));
+    EXPECT_TRUE(world.removeObjectByHandle(handles[2]));
+    EXPECT_FALSE(world.removeObjectByHandle(handles[2]));
+    EXPECT_EQ(world.getObject(1), nullptr);
+    EXPECT_EQ(world.getObjectCount(), 2);
+
+    // Nothing has moved yet.
+    EXPECT_EQ(world.getObjectByHandle(handles[3])->worldIndex, 3);
+    EXPECT_EQ(world.slotIndices[SlotMap<PhysicalObject*>::slotOf(handles[0])], -1);
+
+    world.step();
+
+    EXPECT_EQ(world.liveIntData.size(), 2 * LIVE_INT_EPO);
+    for(int i : {1, 3}){
+        PhysicalObject* object = world.getObjectByHandle(handles[i]);
+        ASSERT_NE(object, nullptr);
+        EXPECT_EQ(world.slotIndices[SlotMap<PhysicalObject*>::slotOf(handles[i])], object->worldIndex);
+        EXPECT_EQ(world.liveIntData[object->worldIndex * LIVE_INT_EPO + LIVE_INT_ID], i + 1);
+    }
+
+    // A new object reuses a slot, and the old handle doesn't reach it.
+    uint32_t reused = world.makeObject(9, options);
+    EXPECT_EQ(SlotMap<PhysicalObject*>::slotOf(reused), SlotMap<PhysicalObject*>::slotOf(handles[2]));
+    EXPECT_EQ(world.getObjectByHandle(handles[2]), nullptr);
+}
+
+// Spawning and despawning objects reuses removed objects, their records, BVH nodes and id
+// entries, so once the pools have filled, churn allocates nothing.
+TEST(WorldTest, ChurnDoesntAllocate) {
+    World world;
+    world.setGravity(0.0f, 0.0f);
+
+    ObjectDesc desc;
+    desc.mass = 1.0f;
+    desc.width = 0.25f;
+    for (int i = 0; i < 50; i++) {
+        desc.x = i * 1.0f;
+        world.makeObject(i + 1, desc);
+    }
+
+    // A removed object's record is taken by the next object made, and nothing moves.
+    int hole = world.getObject(10)->worldIndex;
+    PhysicalObject* last = world.getObject(50);
+    world.removeObject(10);
+    world.makeObject(100, desc);
+    EXPECT_EQ(world.getObject(100)->worldIndex, hole);
+    EXPECT_EQ(last->worldIndex, 49);
+    world.removeObject(100);
+
+    // Despawn the last wave and spawn a new one in its place, away from the other objects.
+    vector<int> wave;
+    int nextId = 1000;
+    auto churn = [&]() {
+        for (int id : wave) world.removeObject(id);
+        wave.clear();
+        for (int i = 0; i < 10; i++) {
+            desc.x = i * 2.0f;
+            desc.y = 5.0f;
+            desc.vx = 1.0f;
+            world.makeObject(nextId, desc);
+            wave.push_back(nextId++);
+        }
+        world.step();
+    };
+
+    for (int i = 0; i < 20; i++) churn();
+
+    startCountingAllocations();
+    for (int i = 0; i < 20; i++) churn();
+    EXPECT_EQ(stopCountingAllocations(), 0);
+    EXPECT_EQ(world.getObjectCount(), 59);
+}
+
+// The per-object buffers grow past their initial capacity, and only move when the buffer
+// generation changes.
+TEST(WorldTest, BuffersGrowWithGeneration) {
+    World world;
+    EXPECT_EQ(world.getObjectCapacity(), INITIAL_OBJECT_CAPACITY);
+    uint32_t generation = world.getBufferGeneration();
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::RIGID_BODY);
+
+    const float* data = world.liveFloatData.data();
+    for (int i = 0; i < INITIAL_OBJECT_CAPACITY; i++) world.makeObject(i + 1, options);
+    EXPECT_EQ(world.liveFloatData.data(), data);
+    EXPECT_EQ(world.getBufferGeneration(), generation);
+
+    world.getObject(1)->setPosition(Vec2(3.0f, 4.0f));
+    world.makeObject(INITIAL_OBJECT_CAPACITY + 1, options);
+    EXPECT_NE(world.getBufferGeneration(), generation);
+    EXPECT_EQ(world.getObjectCapacity(), INITIAL_OBJECT_CAPACITY * 2);
+    EXPECT_FLOAT_EQ(world.getObject(1)->getX(), 3.0f);
+
+    // Reserving up front leaves the buffers alone while they fill.
+    world.reserveObjects(100000);
+    EXPECT_EQ(world.getObjectCapacity(), 100000);
+    generation = world.getBufferGeneration();
+    data = world.liveFloatData.data();
+    for (int i = world.getObjectCount(); i < 5000; i++) world.makeObject(i + 1, options);
+    EXPECT_EQ(world.getObjectCount(), 5000);
+    EXPECT_EQ(world.liveFloatData.data(), data);
+    EXPECT_EQ(world.getBufferGeneration(), generation);
+    EXPECT_FLOAT_EQ(world.getObject(1)->getY(), 4.0f);
+}
+
+// A slot retired after its last generation is never reused, so with the buffers full the next
+// object needs a slot past their capacity. slotIndices then moves, and the generation says so.
+TEST(WorldTest, RetiredSlotsGrowSlotIndicesWithGeneration) {
+    World world;
+    ObjectDesc desc;
+    for (int i = 0; i < INITIAL_OBJECT_CAPACITY; i++) world.makeObject(i + 1, desc);
+    ASSERT_EQ(world.getObjectCapacity(), INITIAL_OBJECT_CAPACITY);
+
+    // Churn the last object through every generation of its slot. Each new object takes the
+    // hole and the slot the last one left.
+    int id = INITIAL_OBJECT_CAPACITY;
+    uint32_t slot = SlotMap<PhysicalObject*>::slotOf(world.getObject(id)->handle);
+    for (uint32_t generation = 1; generation < SLOT_MAP_GENERATION_MASK; generation++) {
+        world.removeObject(id);
+        world.makeObject(++id, desc);
+    }
+    ASSERT_EQ(SlotMap<PhysicalObject*>::slotOf(world.getObject(id)->handle), slot);
+
+    world.removeObject(id);
+    uint32_t generation = world.getBufferGeneration();
+    uint32_t handle = world.makeObject(++id, desc);
+    ASSERT_NE(handle, INVALID_HANDLE);
+    EXPECT_EQ(SlotMap<PhysicalObject*>::slotOf(handle), static_cast<uint32_t>(INITIAL_OBJECT_CAPACITY));
+    EXPECT_EQ(world.getObjectCapacity(), INITIAL_OBJECT_CAPACITY);
+    EXPECT_NE(world.getBufferGeneration(), generation);
+    EXPECT_GT(world.slotIndices.capacity(), SlotMap<PhysicalObject*>::slotOf(handle));
+    EXPECT_EQ(world.getObjectByHandle(handle), world.getObject(id));
+}
+
+// Memory stats follow the scene, and compacting after most objects are gone gives back what they
+// held without touching the ones left.
+TEST(WorldTest, MemoryStatsAndCompact) {
+    World world;
+    world.setGravity(0.0f, 0.0f);
+
+    ObjectDesc desc;
+    desc.mass = 1.0f;
+    desc.width = 0.25f;
+    // Rows of overlapping circles, so the steps have contacts to solve.
+    for (int i = 0; i < 3000; i++) {
+        desc.x = (i % 100) * 0.4f;
+        desc.y = (i / 100) * 0.4f;
+        world.makeObject(i + 1, desc);
+    }
+    world.step();
+
+    MemoryStats before = world.getMemoryStats();
+    EXPECT_GE(before.objects.used, 3000 * FDATA_EPO * sizeof(float));
+    EXPECT_GE(before.objects.reserved, before.objects.used);
+    EXPECT_EQ(before.bvh.used, (2 * 3000 - 1) * sizeof(TreeNode));
+    EXPECT_GT(before.frameArena.highWater, 0);
+    EXPECT_GE(before.total.reserved, before.objects.reserved + before.bvh.reserved);
+
+    for (int i = 10; i < 3000; i++) world.removeObject(i + 1);
+    world.step();
+
+    // Removed objects and nodes are pooled, so nothing was given back yet.
+    MemoryStats removed = world.getMemoryStats();
+    EXPECT_EQ(removed.bvh.used, (2 * 10 - 1) * sizeof(TreeNode));
+    EXPECT_EQ(removed.bvh.reserved, before.bvh.reserved);
+    EXPECT_EQ(removed.objects.highWater, before.objects.highWater);
+
+    float x = world.getObject(10)->getX();
+    uint32_t generation = world.getBufferGeneration();
+    world.compact();
+    EXPECT_NE(world.getBufferGeneration(), generation);
+    EXPECT_EQ(world.getObjectCapacity(), INITIAL_OBJECT_CAPACITY);
+
+    MemoryStats compacted = world.getMemoryStats();
+    EXPECT_LT(compacted.objects.reserved, removed.objects.reserved / 2);
+    EXPECT_EQ(compacted.bvh.reserved, compacted.bvh.used);
+    EXPECT_LT(compacted.lookup.reserved, removed.lookup.reserved);
+    EXPECT_LT(compacted.objects.highWater, before.objects.highWater);
+
+    // The objects left, and handles of removed ones, still work.
+    EXPECT_FLOAT_EQ(world.getObject(10)->getX(), x);
+    world.makeObject(5000, desc);
+    EXPECT_EQ(world.getObjectCount(), 11);
+    EXPECT_EQ(world.getObject(3000), nullptr);
+    world.step();
+    world.step();
+    EXPECT_LT(world.getMemoryStats().frameArena.reserved, before.frameArena.reserved);
+    EXPECT_EQ(world.getObject(10)->id, 10);
+}
+
+// makeObjects appends staged records in one go, derives what makeObject would, and puts the
+// objects in the BVH.
+TEST(WorldTest, MakeObjectsFromStaging) {
+    World world;
+    world.setGravity(0.0f, 0.0f);
+    EXPECT_EQ(world.makeObjects(1), 0);
+
+    world.setStagingCapacity(3);
+    for (int i = 0; i < 3; i++) {
+        int* ints = &world.stagingIntData[i * LIVE_INT_EPO];
+        float* floats = &world.stagingFloatData[i * FDATA_EPO];
+        ints[LIVE_INT_ID] = 10 + i;
+        ints[LIVE_INT_SHAPE] = static_cast<int>(ObjectShape::CIRCLE);
+        ints[LIVE_INT_TYPE] = static_cast<int>(i == 2 ? ObjectType::FIXED_OBJECT : ObjectType::RIGID_BODY);
+        floats[FDATA_X] = 1.0f + i * 1.5f;
+        floats[FDATA_Y] = 1.0f;
+        floats[FDATA_R] = 0.5f;
+        floats[FDATA_M] = 2.0f;
+        floats[FDATA_RADIUS] = 1.0f;
+        floats[FDATA_FX] = 99.0f;  // Not an input, so it's ignored.
+    }
+    EXPECT_EQ(world.makeObjects(4), 0);
+    ASSERT_EQ(world.makeObjects(3), 3);
+    EXPECT_EQ(world.getObjectCount(), 3);
+
+    PhysicalObject* first = world.getObjectByHandle(world.stagingHandles[0]);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first, world.getObject(10));
+    EXPECT_FLOAT_EQ(first->getInverseMass(), 0.5f);
+    EXPECT_FLOAT_EQ(first->getForceX(), 0.0f);
+    EXPECT_FLOAT_EQ(world.liveFloatData[first->worldIndex * FDATA_EPO + FDATA_COS], cos(0.5f));
+    EXPECT_FLOAT_EQ(world.getObject(12)->getMass(), 0.0f);
+
+    // The bodies overlap, so the broad phase has to find them for the step to push them apart.
+    world.step();
+    EXPECT_LT(first->getX(), 1.0f);
+}
+
+// Objects made from an ObjectDesc, or from a spec through MockVal, get every field they set.
+TEST(WorldTest, MakeObjectFromDesc) {
+    World world;
+
+    ObjectDesc desc;
+    desc.x = 2.0f;
+    desc.y = 3.0f;
+    desc.r = 0.25f;
+    desc.mass = 4.0f;
+    desc.width = 0.5f;
+    desc.restitution = 0.7f;
+    world.makeObject(1, desc);
+
+    PhysicalObject* object = world.getObject(1);
+    EXPECT_FLOAT_EQ(object->getX(), 2.0f);
+    EXPECT_FLOAT_EQ(object->getInverseMass(), 0.25f);
+    EXPECT_FLOAT_EQ(object->getRestitution(), 0.7f);
+    EXPECT_FLOAT_EQ(object->getKineticFriction(), 1.0f);
+    EXPECT_FLOAT_EQ(world.liveFloatData[object->worldIndex * FDATA_EPO + FDATA_SIN], sin(0.25f));
+    EXPECT_FLOAT_EQ(object->aabb.min.x, 1.5f);
+    EXPECT_FLOAT_EQ(object->aabb.max.y, 3.5f);
+
+    MockVal options;
+    options.properties["type"] = static_cast<int>(ObjectType::FIXED_OBJECT);
+    options.properties["shape"] = static_cast<int>(ObjectShape::BOX);
+    options.properties["x"] = 5;
+    options.properties["mass"] = 3.0f;
+    options.properties["width"] = 2.0f;
+    options.properties["height"] = 1.0f;
+    world.makeObject(2, options);
+
+    PhysicalObject* fixed = world.getObject(2);
+    EXPECT_EQ(fixed->shape, ObjectShape::BOX);
+    EXPECT_FLOAT_EQ(fixed->getX(), 5.0f);
+    EXPECT_FLOAT_EQ(fixed->getMass(), 0.0f);
+    EXPECT_FLOAT_EQ(world.liveFloatData[fixed->worldIndex * FDATA_EPO + FDATA_H], 1.0f);
+}